@@ -0,0 +1,103 @@
+/* Run a 10 ms PeriodicTimer whose do_it takes 5 ms, then 15 ms, then 3 ms
+again, with a fixed interval and in adaptive mode, and report for each phase
+the calls per second, the share of the time do_it kept the thread busy, and
+the interval the timer ended the phase with.
+
+With a fixed interval the 15 ms phase runs back-to-back and keeps the CPU
+busy all of the time. In adaptive mode the interval stretches until do_it
+takes between 50% and 90% of it, and comes back to 10 ms in the last phase.
+*/
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <iostream>
+#include <iomanip>
+
+#include "intervals.h"
+#include "platform.h"
+#include "periodic_timer.h"
+#include "bench_util.h"
+
+#define PHASES                  3
+// 2 s == 2,000,000,000 ns
+#define PHASE_RUNTIME           resolution(2000000000)
+// 40 ms == 40,000,000 ns
+#define BENCH_MAX_INTERVAL      resolution(40000000)
+
+
+struct Phase {
+    resolution  cost;
+    uint64_t    calls = 0;
+    duration    busy = duration(0);
+    resolution  interval_at_end = resolution(0);
+};
+
+
+void
+    measure(const char* name, const AdaptiveInterval& bounds) {
+    // 5 ms, 15 ms and 3 ms
+    Phase phases[PHASES];
+    phases[0].cost = resolution(5000000);
+    phases[1].cost = resolution(15000000);
+    phases[2].cost = resolution(3000000);
+
+    PeriodicTimer<0, 0> timer(INTERVAL_PERIOD);
+    timer.set_adaptive(bounds);
+    {
+        QuietCout quiet;
+        my_clock::time_point time_start = my_clock::now();
+        timer.interval_current_start([&](resolution) {
+            my_clock::time_point time_call = my_clock::now();
+            size_t phase = std::min(static_cast<size_t>(
+                (time_call - time_start) / PHASE_RUNTIME), size_t(PHASES - 1));
+            while (my_clock::now() < time_call + phases[phase].cost) {
+                cpu_relax();
+            }
+
+            ++phases[phase].calls;
+            phases[phase].busy += my_clock::now() - time_call;
+        });
+
+        for (Phase& phase : phases) {
+            std::this_thread::sleep_for(PHASE_RUNTIME);
+            phase.interval_at_end = timer.effective_interval();
+        }
+
+        timer.stop();
+    }
+
+    for (size_t i = 0; i < PHASES; ++i) {
+        double seconds = static_cast<double>(PHASE_RUNTIME.count()) / 1e9;
+        std::cout << std::left << std::setw(10) << std::setfill(' ')
+            << (i == 0 ? name : "") << std::right
+            << std::setw(9) << std::chrono::duration_cast<millisec>(
+                phases[i].cost).count()
+            << std::fixed << std::setprecision(1)
+            << std::setw(10) << static_cast<double>(phases[i].calls) / seconds
+            << std::setprecision(0)
+            << std::setw(9) << 100.0 * static_cast<double>(phases[i].busy.count())
+                / static_cast<double>(PHASE_RUNTIME.count()) << "%"
+            << std::setprecision(1)
+            << std::setw(12) << static_cast<double>(phases[i].interval_at_end.count())
+                / 1e6 << std::endl;
+    }
+}
+
+
+int main() {
+    std::cout << "Each phase lasts "
+        << std::chrono::duration_cast<millisec>(PHASE_RUNTIME).count()
+        << " ms, with a nominal interval of "
+        << std::chrono::duration_cast<millisec>(INTERVAL_PERIOD).count()
+        << " ms." << std::endl << std::endl;
+    std::cout << "Mode      do_it ms   Calls/s     Busy  Interval ms" << std::endl;
+
+    measure("fixed", AdaptiveInterval());
+
+    AdaptiveInterval bounds;
+    bounds.max_interval = BENCH_MAX_INTERVAL;
+    measure("adaptive", bounds);
+    return 0;
+}
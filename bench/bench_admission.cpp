@@ -0,0 +1,100 @@
+/* Overload a scheduler with more work than fits in an interval, and compare
+running every callback with shedding or deferring the low-priority ones.
+
+Normal timers have short callbacks. Low-priority timers have long ones, and
+together the callbacks need about 40% more time than the interval has. For
+each admission policy it reports how many of the expected normal and
+low-priority calls ran, the missed intervals, how many low-priority calls
+were shed and deferred, and the p99 and largest dispatch latency.
+*/
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <iostream>
+#include <iomanip>
+
+#include "intervals.h"
+#include "platform.h"
+#include "scheduler.h"
+
+// 3 s == 3,000,000,000 ns
+#define BENCH_RUNTIME           resolution(3000000000)
+#define NORMAL_TIMERS           10
+// 0.2 ms == 200,000 ns
+#define NORMAL_COST             resolution(200000)
+#define LOW_TIMERS              20
+// 0.6 ms == 600,000 ns
+#define LOW_COST                resolution(600000)
+
+
+//! @brief keep the CPU busy for cost, like a callback doing real work.
+void
+    busy(resolution cost) {
+    my_clock::time_point until = my_clock::now() + cost;
+    while (my_clock::now() < until) {
+        cpu_relax();
+    }
+}
+
+
+void
+    measure(const char* name, Admission policy) {
+    HeapScheduler scheduler;
+    scheduler.set_admission(policy);
+    std::atomic<uint64_t> normal_calls(0);
+    std::atomic<uint64_t> low_calls(0);
+    for (int i = 0; i < NORMAL_TIMERS; ++i) {
+        scheduler.add(INTERVAL_PERIOD, resolution(JITTER_MIN),
+                      resolution(JITTER_MAX), [&](resolution) {
+            busy(NORMAL_COST);
+            ++normal_calls;
+        });
+    }
+
+    for (int i = 0; i < LOW_TIMERS; ++i) {
+        scheduler.add(INTERVAL_PERIOD, resolution(JITTER_MIN),
+                      resolution(JITTER_MAX), [&](resolution) {
+            busy(LOW_COST);
+            ++low_calls;
+        }, resolution(0), Priority::LOW);
+    }
+
+    scheduler.start();
+    std::this_thread::sleep_for(BENCH_RUNTIME);
+    scheduler.stop();
+
+    SchedulerStats stats = scheduler.stats();
+    uint64_t expected = static_cast<uint64_t>(BENCH_RUNTIME / INTERVAL_PERIOD);
+    std::cout << std::left << std::setw(8) << name << std::right
+        << std::fixed << std::setprecision(0)
+        << std::setw(9) << 100.0 * static_cast<double>(normal_calls.load())
+            / static_cast<double>(expected * NORMAL_TIMERS) << "%"
+        << std::setw(8) << 100.0 * static_cast<double>(low_calls.load())
+            / static_cast<double>(expected * LOW_TIMERS) << "%"
+        << std::setw(9) << stats.missed_intervals
+        << std::setw(8) << stats.shed
+        << std::setw(10) << stats.deferred
+        << std::setw(10) << std::chrono::duration_cast<microsec>(
+            stats.dispatch_latency.percentile(0.99)).count()
+        << std::setw(10) << std::chrono::duration_cast<microsec>(
+            stats.dispatch_latency.largest()).count() << std::endl;
+}
+
+
+int main() {
+    std::cout << NORMAL_TIMERS << " normal timers of "
+        << std::chrono::duration_cast<microsec>(NORMAL_COST).count()
+        << " us and " << LOW_TIMERS << " low-priority timers of "
+        << std::chrono::duration_cast<microsec>(LOW_COST).count()
+        << " us, every "
+        << std::chrono::duration_cast<millisec>(INTERVAL_PERIOD).count()
+        << " ms. Lateness is in us." << std::endl << std::endl;
+    std::cout << "Policy    Normal     Low   Missed    Shed  Deferred"
+        "  p99 late  Max late" << std::endl;
+    measure("off", Admission::OFF);
+    measure("shed", Admission::SHED);
+    measure("defer", Admission::DEFER);
+    return 0;
+}
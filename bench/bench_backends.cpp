@@ -0,0 +1,130 @@
+/* Compare the cost of inserting, cancelling and expiring timers in the two
+scheduler backends, the hierarchical timing wheel and the 4-ary deadline heap.
+
+Each run inserts a number of timers with deadlines spread over BENCH_SPAN,
+cancels half of them in random order, and then expires the rest the way the
+scheduler thread does: by advancing to next_expiry() until nothing is left.
+Small runs are repeated so every measurement covers about BENCH_OPERATIONS
+timers.
+*/
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <random>
+#include <memory>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+
+#include "intervals.h"
+#include "timer_node.h"
+#include "timing_wheel.h"
+#include "deadline_heap.h"
+
+// 10 s == 10,000,000,000 ns
+#define BENCH_SPAN              resolution(10000000000)
+
+// Minimum number of timers measured for each size
+#define BENCH_OPERATIONS        1000000
+
+
+struct BackendCosts {
+    double  insert_ns = 0.0;
+    double  cancel_ns = 0.0;
+    double  expire_ns = 0.0;
+};
+
+
+template <typename Backend>
+BackendCosts
+    measure(size_t count, uint32_t seed) {
+    BackendCosts result;
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<resolution::rep> distribution(0,
+                                                                BENCH_SPAN.count());
+    size_t rounds = std::max<size_t>(1, BENCH_OPERATIONS / count);
+    duration insert_time(0);
+    duration cancel_time(0);
+    duration expire_time(0);
+    size_t cancelled = 0;
+    size_t expired = 0;
+
+    for (size_t round = 0; round < rounds; ++round) {
+        my_clock::time_point origin = my_clock::now();
+        std::vector<TimerNode> nodes(count);
+        for (auto& node : nodes) {
+            node.deadline = origin + resolution(distribution(gen));
+        }
+
+        std::vector<TimerNode*> victims;
+        for (size_t i = 0; i < count; i += 2) {
+            victims.push_back(&nodes[i]);
+        }
+
+        std::shuffle(victims.begin(), victims.end(), gen);
+
+        // The wheel is too big to put on the stack comfortably
+        std::unique_ptr<Backend> backend(new Backend(origin));
+
+        my_clock::time_point time_start = my_clock::now();
+        for (auto& node : nodes) {
+            backend->insert(&node);
+        }
+
+        my_clock::time_point time_inserted = my_clock::now();
+        for (TimerNode* node : victims) {
+            backend->cancel(node);
+        }
+
+        my_clock::time_point time_cancelled = my_clock::now();
+        while (!backend->empty()) {
+            backend->advance(backend->next_expiry(), [&expired](TimerNode*) {
+                ++expired;
+            });
+        }
+
+        my_clock::time_point time_expired = my_clock::now();
+        insert_time += time_inserted - time_start;
+        cancel_time += time_cancelled - time_inserted;
+        expire_time += time_expired - time_cancelled;
+        cancelled += victims.size();
+    }
+
+    result.insert_ns = static_cast<double>(insert_time.count())
+        / static_cast<double>(rounds * count);
+    result.cancel_ns = static_cast<double>(cancel_time.count())
+        / static_cast<double>(cancelled);
+    result.expire_ns = static_cast<double>(expire_time.count())
+        / static_cast<double>(expired);
+    return result;
+}
+
+
+void
+    report(const char* name, size_t count, const BackendCosts& costs) {
+    std::cout << std::setw(9) << std::setfill(' ') << count << "  "
+        << std::left << std::setw(7) << name << std::right
+        << std::fixed << std::setprecision(1)
+        << std::setw(10) << costs.insert_ns
+        << std::setw(10) << costs.cancel_ns
+        << std::setw(10) << costs.expire_ns << std::endl;
+}
+
+
+int main() {
+    const size_t counts[] = {10, 1000, 100000, 1000000};
+
+    std::cout << "Cost per timer in ns. Deadlines are spread over "
+        << std::chrono::duration_cast<millisec>(BENCH_SPAN).count()
+        << " ms." << std::endl << std::endl;
+    std::cout << "   Timers  Backend    Insert    Cancel    Expire"
+        << std::endl;
+
+    for (size_t count : counts) {
+        report("wheel", count, measure<TimingWheel>(count, 1));
+        report("heap", count, measure<DeadlineHeap>(count, 1));
+    }
+
+    return 0;
+}
@@ -0,0 +1,116 @@
+/* Time per jitter in [JITTER_MIN, JITTER_MAX] drawn one at a time from
+std::mt19937 with std::uniform_int_distribution, from xoshiro256++, and from
+BlockGenerator, both one at a time and a buffer at a time with fill(). Build
+with -mavx2 (or /arch:AVX2) to run BlockGenerator's lanes on AVX2.
+
+Then a chi-squared test of BlockGenerator's jitters: they're counted in
+equal buckets across the range, and the statistic is compared with the value
+a uniform distribution stays under 99% of the time.
+*/
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+#include "intervals.h"
+#include "random.h"
+#include "block_generator.h"
+
+#define BENCH_DRAWS             10000000
+#define BENCH_BUFFER            1024
+#define TEST_DRAWS              10000000
+#define TEST_BUCKETS            100
+// The 99th percentile of chi-squared with 99 degrees of freedom
+#define TEST_CRITICAL           134.64
+
+
+//! @brief the average time to draw one jitter with draw.
+template <typename Draw>
+double
+    time_per_draw(Draw draw) {
+    resolution::rep sum = 0;
+    my_clock::time_point time_start = my_clock::now();
+    for (int i = 0; i < BENCH_DRAWS; ++i) {
+        sum += draw().count();
+    }
+
+    duration elapsed = my_clock::now() - time_start;
+    // Keep the draws from being optimized away
+    volatile resolution::rep sink = sum;
+    (void)sink;
+    return static_cast<double>(elapsed.count()) / BENCH_DRAWS;
+}
+
+
+void
+    report(const char* name, double ns) {
+    std::cout << "  " << std::left << std::setw(28) << std::setfill(' ')
+        << name << std::right << std::fixed << std::setprecision(2)
+        << std::setw(8) << ns << " ns" << std::endl;
+}
+
+
+int main() {
+    std::cout << "Per jitter draw, lanes "
+        << (BlockGenerator::vectorized() ? "on AVX2" : "in scalar code")
+        << ":" << std::endl;
+
+    std::mt19937 mt(12345);
+    std::uniform_int_distribution<resolution::rep> distribution(JITTER_MIN,
+                                                                JITTER_MAX);
+    report("mt19937 + distribution", time_per_draw([&]() {
+        return resolution(distribution(mt));
+    }));
+
+    Xoshiro256pp xoshiro(12345);
+    report("xoshiro256++", time_per_draw([&]() {
+        return resolution(uniform_in(xoshiro, JITTER_MIN, JITTER_MAX));
+    }));
+
+    BlockGenerator block(12345);
+    report("BlockGenerator", time_per_draw([&]() {
+        return resolution(uniform_in(block, JITTER_MIN, JITTER_MAX));
+    }));
+
+    std::vector<resolution> buffer(BENCH_BUFFER);
+    resolution::rep sum = 0;
+    my_clock::time_point time_start = my_clock::now();
+    for (int i = 0; i < BENCH_DRAWS / BENCH_BUFFER; ++i) {
+        block.fill(buffer.data(), buffer.size(), resolution(JITTER_MIN),
+                   resolution(JITTER_MAX));
+        sum += buffer[static_cast<size_t>(i) % BENCH_BUFFER].count();
+    }
+
+    duration elapsed = my_clock::now() - time_start;
+    volatile resolution::rep sink = sum;
+    (void)sink;
+    report("BlockGenerator::fill()", static_cast<double>(elapsed.count())
+           / (BENCH_DRAWS / BENCH_BUFFER * BENCH_BUFFER));
+
+    // Uniformity
+    std::vector<uint64_t> buckets(TEST_BUCKETS);
+    const uint64_t span = JITTER_MAX - JITTER_MIN + 1;
+    for (int i = 0; i < TEST_DRAWS; ++i) {
+        uint64_t offset = static_cast<uint64_t>(
+            uniform_in(block, JITTER_MIN, JITTER_MAX) - JITTER_MIN);
+        ++buckets[static_cast<size_t>(offset * TEST_BUCKETS / span)];
+    }
+
+    double expected = static_cast<double>(TEST_DRAWS) / TEST_BUCKETS;
+    double chi_squared = 0;
+    for (uint64_t count : buckets) {
+        double difference = static_cast<double>(count) - expected;
+        chi_squared += difference * difference / expected;
+    }
+
+    std::cout << std::endl << "Chi-squared over " << TEST_BUCKETS
+        << " buckets of " << TEST_DRAWS << " jitters: " << std::fixed
+        << std::setprecision(1) << chi_squared << ", "
+        << (chi_squared < TEST_CRITICAL ? "uniform" : "NOT uniform")
+        << " at the 1% level (critical value " << TEST_CRITICAL << ")."
+        << std::endl;
+    return chi_squared < TEST_CRITICAL ? 0 : 1;
+}
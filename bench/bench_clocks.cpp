@@ -0,0 +1,97 @@
+/* The cost of reading each clock source, and of a doItCounted iteration
+that reads it.
+
+First, the time per now() call and the precision of each clock. Then the
+time per iteration of a PeriodicTimer with no interval and no jitter, so the
+loop itself is all that's measured, telling the time with each clock through
+ClockedSleeper.
+*/
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+
+#include "intervals.h"
+#include "clocks.h"
+#include "sleepers.h"
+#include "periodic_timer.h"
+#include "bench_util.h"
+
+#define BENCH_READS             10000000
+#define BENCH_ITERATIONS        200000
+
+
+//! @brief the average time of one Clock::now() call.
+template <typename Clock>
+double
+    time_reads() {
+    my_clock::rep sum = 0;
+    my_clock::time_point time_start = my_clock::now();
+    for (int i = 0; i < BENCH_READS; ++i) {
+        sum += Clock::now().time_since_epoch().count();
+    }
+
+    duration elapsed = my_clock::now() - time_start;
+    // Keep the reads from being optimized away
+    volatile my_clock::rep sink = sum;
+    (void)sink;
+    return static_cast<double>(elapsed.count()) / BENCH_READS;
+}
+
+
+//! @brief the smallest step between two different readings of Clock.
+template <typename Clock>
+resolution
+    smallest_step() {
+    my_clock::time_point first = Clock::now();
+    my_clock::time_point next = first;
+    while (next == first) {
+        next = Clock::now();
+    }
+
+    return next - first;
+}
+
+
+//! @brief the average time of one doItCounted iteration.
+template <typename Clock>
+double
+    time_iterations() {
+    PeriodicTimer<0, 0, ClockedSleeper<ConditionSleeper, Clock>> timer(
+        resolution(0));
+    QuietCout quiet;
+    my_clock::time_point time_start = my_clock::now();
+    timer.doItCounted([](resolution) {}, BENCH_ITERATIONS);
+    duration elapsed = my_clock::now() - time_start;
+    return static_cast<double>(elapsed.count()) / BENCH_ITERATIONS;
+}
+
+
+template <typename Clock>
+void
+    report(const char* name) {
+    // Measured before printing, since time_iterations() silences std::cout
+    double per_read = time_reads<Clock>();
+    resolution step = smallest_step<Clock>();
+    double per_iteration = time_iterations<Clock>();
+    std::cout << std::left << std::setw(12) << std::setfill(' ') << name
+        << std::right << std::fixed << std::setprecision(1)
+        << std::setw(10) << per_read
+        << std::setw(12) << step.count()
+        << std::setw(15) << per_iteration << std::endl;
+}
+
+
+int main() {
+    std::cout << "Times are in ns." << std::endl << std::endl;
+    std::cout << "Clock         Per read        Step  Per iteration" << std::endl;
+    report<SteadyClock>("steady");
+#if defined(__linux__)
+    report<MonotonicClock>("monotonic");
+    report<CoarseClock>("coarse");
+    std::cout << std::endl << "CLOCK_MONOTONIC_COARSE's resolution is "
+        << CoarseClock::precision().count() << " ns." << std::endl;
+#endif
+    return 0;
+}
@@ -0,0 +1,109 @@
+/* Add and cancel timers from 1 to 64 producer threads at once while the
+scheduler runs, and measure how many commands per second get through and how
+long a producer spends in add() and cancel(). The commands go through the
+scheduler's lock-free queue, so producers never wait for the scheduler thread
+or for each other's locks.
+*/
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+#include "intervals.h"
+#include "scheduler.h"
+
+// Timers each producer adds and then cancels
+#define BENCH_OPERATIONS        20000
+// Timers that keep the scheduler busy meanwhile
+#define BENCH_BACKGROUND        1000
+
+
+void
+    measure(size_t producers) {
+    WheelScheduler scheduler;
+    for (size_t i = 0; i < BENCH_BACKGROUND; ++i) {
+        scheduler.add(INTERVAL_PERIOD, resolution(JITTER_MIN),
+                      resolution(JITTER_MAX), [](resolution) {});
+    }
+
+    scheduler.start();
+
+    std::mutex mutex;
+    DurationStats add_time;
+    DurationStats cancel_time;
+    std::atomic<bool> go(false);
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&]() {
+            DurationStats adds;
+            DurationStats cancels;
+            while (!go.load()) {
+                std::this_thread::yield();
+            }
+
+            for (int i = 0; i < BENCH_OPERATIONS; ++i) {
+                my_clock::time_point time_start = my_clock::now();
+                WheelScheduler::TimerId id = scheduler.add(
+                    INTERVAL_PERIOD, resolution(JITTER_MIN),
+                    resolution(JITTER_MAX), [](resolution) {});
+                my_clock::time_point time_added = my_clock::now();
+                scheduler.cancel(id);
+                my_clock::time_point time_cancelled = my_clock::now();
+
+                adds.insert(time_added - time_start);
+                cancels.insert(time_cancelled - time_added);
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            add_time.merge(adds);
+            cancel_time.merge(cancels);
+        });
+    }
+
+    my_clock::time_point time_start = my_clock::now();
+    go.store(true);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // Wait for the scheduler thread to apply every command
+    uint64_t commands = BENCH_BACKGROUND
+        + 2 * BENCH_OPERATIONS * static_cast<uint64_t>(producers);
+    while (scheduler.commands_applied() != commands) {
+        std::this_thread::yield();
+    }
+
+    duration elapsed = my_clock::now() - time_start;
+    scheduler.stop();
+
+    double per_second = static_cast<double>(commands - BENCH_BACKGROUND) * 1e9
+        / static_cast<double>(elapsed.count());
+    std::cout << std::setw(9) << std::setfill(' ') << producers
+        << std::setw(14) << static_cast<uint64_t>(per_second)
+        << std::setw(10) << add_time.average().count()
+        << std::setw(12) << add_time.largest().count() / 1000
+        << std::setw(12) << cancel_time.average().count()
+        << std::setw(12) << cancel_time.largest().count() / 1000
+        << std::endl;
+}
+
+
+int main() {
+    const size_t counts[] = {1, 2, 4, 8, 16, 32, 64};
+
+    std::cout << "Each producer adds and cancels " << BENCH_OPERATIONS
+        << " timers. Averages are in ns, maximums in us." << std::endl
+        << std::endl;
+    std::cout << "Producers  Commands/s  Add avg   Add max  Cancel avg"
+        "  Cancel max" << std::endl;
+    for (size_t producers : counts) {
+        measure(producers);
+    }
+
+    return 0;
+}
@@ -0,0 +1,96 @@
+/* Run 100k periodic tasks as coroutines waiting in co_await
+timer.next_tick(), all resumed by one scheduler thread, and report what each
+task costs in memory and how late it's resumed. With PeriodicTimer, each of
+them would need a thread and its stack.
+
+Coroutines need C++20, so build this with -std=c++20 or /std:c++20.
+*/
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+#include "intervals.h"
+#include "platform.h"
+#include "scheduler.h"
+#include "coroutine_timer.h"
+
+// 3 s == 3,000,000,000 ns
+#define BENCH_RUNTIME           resolution(3000000000)
+// 1 s == 1,000,000,000 ns
+#define BENCH_INTERVAL          resolution(1000000000)
+#define BENCH_TASKS             100000
+
+#if defined(INTERVALS_HAVE_COROUTINES)
+
+PeriodicTask
+    count_ticks(CoroutineTimer<>& timer, uint64_t& ticks) {
+    for (;;) {
+        co_await timer.next_tick();
+        ++ticks;
+    }
+}
+
+
+int main() {
+    WheelScheduler scheduler;
+    std::vector<std::unique_ptr<CoroutineTimer<>>> timers;
+    std::vector<uint64_t> ticks(BENCH_TASKS, 0);
+
+    for (size_t i = 0; i < BENCH_TASKS; ++i) {
+        timers.emplace_back(new CoroutineTimer<>(scheduler, BENCH_INTERVAL,
+                                                 resolution(JITTER_MIN),
+                                                 BENCH_INTERVAL));
+        count_ticks(*timers.back(), ticks[i]);
+    }
+
+    size_t frame_bytes = PeriodicTask::frame_bytes();
+    duration cpu_start = process_cpu_time();
+    my_clock::time_point time_start = my_clock::now();
+    scheduler.start();
+    std::this_thread::sleep_for(BENCH_RUNTIME);
+    scheduler.stop();
+    duration elapsed = my_clock::now() - time_start;
+    duration cpu_time = process_cpu_time() - cpu_start;
+
+    uint64_t total_ticks = 0;
+    uint64_t missed_ticks = 0;
+    for (size_t i = 0; i < BENCH_TASKS; ++i) {
+        total_ticks += ticks[i];
+        missed_ticks += timers[i]->missed_ticks();
+    }
+
+    SchedulerStats stats = scheduler.stats();
+    std::cout << "Tasks: " << BENCH_TASKS << std::endl;
+    std::cout << "Coroutine frame bytes per task: "
+        << frame_bytes / BENCH_TASKS << std::endl;
+    std::cout << "Ticks: " << total_ticks << ", missed: " << missed_ticks
+        << std::endl;
+    std::cout << "Average/Longest resume latency (us): "
+        << std::chrono::duration_cast<microsec>(
+            stats.dispatch_latency.average()).count() << " / "
+        << std::chrono::duration_cast<microsec>(
+            stats.dispatch_latency.largest()).count() << std::endl;
+    std::cout << "CPU (ms/s): " << std::fixed << std::setprecision(1)
+        << static_cast<double>(cpu_time.count())
+            / static_cast<double>(elapsed.count()) * 1000.0 << std::endl;
+
+    // The scheduler is stopped, so the waiting coroutines can be destroyed
+    timers.clear();
+    std::cout << "Frame bytes left after destroying the timers: "
+        << PeriodicTask::frame_bytes() << std::endl;
+    return 0;
+}
+
+#else
+
+int main() {
+    std::cout << "This benchmark needs C++20 coroutines." << std::endl;
+    return 0;
+}
+
+#endif
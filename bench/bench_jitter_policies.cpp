@@ -0,0 +1,182 @@
+/* How evenly each jitter policy in jitter.h spreads the calls of a fleet of
+clients at the server. The clients all start in step, as after a deploy or a
+server restart, and each calls once per 10 ms interval, at the jitter its
+policy draws. The PhaseJitter clients are named client-0 to client-9999, or
+numbered 0 to 9999 for the stratified slots. The calls are counted in 100 us buckets, and for each policy
+the bench prints
+
+    Peak/mean   the busiest bucket, against the average bucket
+    CV          the standard deviation of the buckets over their average
+    Min gap     the shortest time between two calls of one client
+    Draw        the time per jitter draw
+
+A perfectly smooth fleet has a peak/mean near 1 and a CV near 0.
+
+It fails if a policy that fits its jitter into the interval draws anything but
+0 for an interval of 0 or less, or if the last of 2^32 stratified slots of a
+100 s interval isn't where it belongs, just short of the end.
+*/
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+#include "intervals.h"
+#include "random.h"
+#include "jitter.h"
+
+#define FLEET_CLIENTS           10000
+#define FLEET_ROUNDS            50
+#define BUCKET_WIDTH            100000
+#define BENCH_DRAWS             10000000
+
+
+//! @brief print the row of Jitter, where setup(jitter, client) sets up the
+// jitter of each client.
+template <typename Jitter, typename Setup>
+void
+    report(const char* name, Setup setup) {
+    const resolution::rep interval = INTERVAL_PERIOD.count();
+    std::vector<uint32_t> buckets(
+        static_cast<size_t>(FLEET_ROUNDS * interval / BUCKET_WIDTH));
+    resolution::rep min_gap = interval * 2;
+    for (uint64_t client = 0; client < FLEET_CLIENTS; ++client) {
+        Jitter jitter;
+        setup(jitter, client);
+        Xoshiro256pp gen(client);
+        resolution::rep last = -interval;
+        for (resolution::rep round = 0; round < FLEET_ROUNDS; ++round) {
+            resolution::rep call = round * interval
+                + jitter.next(gen, INTERVAL_PERIOD).count();
+            ++buckets[static_cast<size_t>(call / BUCKET_WIDTH)];
+            if (round > 0) {
+                min_gap = std::min(min_gap, call - last);
+            }
+
+            last = call;
+        }
+    }
+
+    double mean = static_cast<double>(FLEET_CLIENTS) * FLEET_ROUNDS
+        / static_cast<double>(buckets.size());
+    double squares = 0;
+    for (uint32_t count : buckets) {
+        double difference = count - mean;
+        squares += difference * difference;
+    }
+
+    double cv = std::sqrt(squares / static_cast<double>(buckets.size())) / mean;
+    uint32_t peak = *std::max_element(buckets.begin(), buckets.end());
+
+    Jitter jitter;
+    setup(jitter, 0);
+    Xoshiro256pp gen(12345);
+    resolution::rep sum = 0;
+    my_clock::time_point time_start = my_clock::now();
+    for (int i = 0; i < BENCH_DRAWS; ++i) {
+        sum += jitter.next(gen, INTERVAL_PERIOD).count();
+    }
+
+    duration elapsed = my_clock::now() - time_start;
+    // Keep the draws from being optimized away
+    volatile resolution::rep sink = sum;
+    (void)sink;
+
+    std::cout << std::left << std::setw(28) << std::setfill(' ') << name
+        << std::right << std::fixed << std::setprecision(2)
+        << std::setw(10) << peak / mean
+        << std::setw(8) << cv
+        << std::setw(10) << min_gap / 1000
+        << std::setw(8) << static_cast<double>(elapsed.count()) / BENCH_DRAWS
+        << std::endl;
+}
+
+
+template <typename Jitter>
+void
+    report(const char* name) {
+    report<Jitter>(name, [](Jitter&, uint64_t) {});
+}
+
+
+//! @brief whether Jitter draws 0 for an empty or negative interval.
+template <typename Jitter>
+bool
+    handles_empty_interval(const char* name) {
+    Jitter jitter;
+    Xoshiro256pp gen(12345);
+    bool handled = true;
+    const resolution intervals[] = {resolution(0), resolution(-1),
+                                    -INTERVAL_PERIOD};
+    for (resolution interval : intervals) {
+        for (int i = 0; i < 100; ++i) {
+            handled = handled && jitter.next(gen, interval) == resolution(0);
+        }
+    }
+
+    std::cout << name << " draws 0 for an interval of 0 or less: "
+        << (handled ? "yes" : "NO") << std::endl;
+    return handled;
+}
+
+
+//! @brief whether PhaseJitter places the last of many slots of a long
+// interval right, where slot * interval overflows 64 bits.
+bool
+    places_last_slot() {
+    const uint64_t slots = uint64_t(1) << 32;
+    const resolution interval = std::chrono::seconds(100);
+    PhaseJitter jitter;
+    jitter.set_slot(slots - 1, slots);
+    Xoshiro256pp gen(12345);
+    resolution phase = jitter.next(gen, interval);
+    // (slots - 1) * interval / slots rounded down, which is interval less
+    // interval / slots rounded up
+    resolution::rep span = static_cast<resolution::rep>(slots);
+    resolution expected = interval
+        - resolution((interval.count() + span - 1) / span);
+    bool placed = phase == expected;
+    std::cout << "Phase places the last of 2^32 slots of 100 s at "
+        << phase.count() << " ns: " << (placed ? "yes" : "NO") << std::endl;
+    return placed;
+}
+
+
+int main() {
+    std::cout << FLEET_CLIENTS << " clients, " << FLEET_ROUNDS
+        << " intervals of "
+        << std::chrono::duration_cast<millisec>(INTERVAL_PERIOD).count()
+        << " ms, " << BUCKET_WIDTH / 1000 << " us buckets." << std::endl
+        << std::endl;
+    std::cout << std::left << std::setw(28) << "Policy" << std::right
+        << std::setw(10) << "Peak/mean" << std::setw(8) << "CV"
+        << std::setw(10) << "Min gap" << std::setw(8) << "Draw" << std::endl
+        << std::setw(56) << "(us)" << std::setw(8) << "(ns)" << std::endl;
+    report<StaticJitter<JITTER_MIN, JITTER_MAX>>("Uniform, 100-1000 us");
+    report<FullJitter>("Full");
+    report<EqualJitter>("Equal");
+    report<DecorrelatedJitter<JITTER_MIN, 9999999>>("Decorrelated, 0.1-10 ms");
+    // A mean of a quarter of the interval
+    report<ExponentialJitter<2500000>>("Exponential, mean 2.5 ms");
+    report<PhaseJitter>("Phase, hashed ID", [](PhaseJitter& jitter,
+                                              uint64_t client) {
+        jitter.set(hash_client_id("client-" + std::to_string(client)));
+    });
+    report<PhaseJitter>("Phase, stratified", [](PhaseJitter& jitter,
+                                               uint64_t client) {
+        jitter.set_slot(client, FLEET_CLIENTS);
+    });
+
+    std::cout << std::endl;
+    bool handled = handles_empty_interval<FullJitter>("Full");
+    handled = handles_empty_interval<EqualJitter>("Equal") && handled;
+    handled = handles_empty_interval<ExponentialJitter<2500000>>("Exponential")
+        && handled;
+    bool placed = places_last_slot();
+    return handled && placed ? 0 : 1;
+}
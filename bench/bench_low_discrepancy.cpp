@@ -0,0 +1,128 @@
+/* Compare uniform random jitter with golden ratio (low-discrepancy) jitter,
+both in [JITTER_MIN, JITTER_MAX], on 100 timers in one process that each run
+1000 iterations. The jitter range is cut into 90 buckets of 10 us, and for
+each policy the bench prints
+
+    Peak/tick   the busiest bucket of an iteration, across the 100 timers,
+                averaged over the iterations. The ideal is 2 (100 timers in
+                90 buckets).
+    Peak/timer  the busiest bucket of one timer's 1000 jitters, against the
+                average bucket, averaged over the timers. The ideal is 1.
+    Draw        the time per jitter draw
+
+GoldenRatioJitter gives each timer its own sequence, which spreads each
+timer's iterations evenly. The timers take their starts from one golden ratio
+sequence, so they keep evenly apart in each iteration too. With a seed per
+timer instead, their starts are random and they're spread no better than
+random jitters. SharedGoldenRatioJitter gives them all one sequence, which
+spreads the timers of each iteration evenly, for an atomic operation a draw.
+*/
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+#include "intervals.h"
+#include "random.h"
+#include "jitter.h"
+
+#define BENCH_TIMERS            100
+#define BENCH_ITERATIONS        1000
+#define BUCKET_COUNT            90
+#define BENCH_DRAWS             10000000
+
+
+//! @brief the bucket of jitter.
+size_t
+    bucket_of(resolution jitter) {
+    return static_cast<size_t>(
+        (jitter.count() - JITTER_MIN) * BUCKET_COUNT
+        / (JITTER_MAX - JITTER_MIN + 1));
+}
+
+
+//! @brief print the row of the Jitters make(timer) makes.
+template <typename Jitter, typename Make>
+void
+    report(const char* name, Make make) {
+    std::vector<Jitter> jitters;
+    std::vector<Xoshiro256pp> gens;
+    for (uint64_t timer = 0; timer < BENCH_TIMERS; ++timer) {
+        jitters.push_back(make(timer));
+        gens.emplace_back(timer);
+    }
+
+    // Each iteration of all timers, and each timer over all iterations
+    std::vector<std::vector<uint32_t>> per_timer(
+        BENCH_TIMERS, std::vector<uint32_t>(BUCKET_COUNT));
+    uint64_t tick_peaks = 0;
+    for (int iteration = 0; iteration < BENCH_ITERATIONS; ++iteration) {
+        std::vector<uint32_t> per_tick(BUCKET_COUNT);
+        for (size_t timer = 0; timer < BENCH_TIMERS; ++timer) {
+            size_t bucket = bucket_of(
+                jitters[timer].next(gens[timer], INTERVAL_PERIOD));
+            ++per_tick[bucket];
+            ++per_timer[timer][bucket];
+        }
+
+        tick_peaks += *std::max_element(per_tick.begin(), per_tick.end());
+    }
+
+    double timer_peaks = 0;
+    for (const std::vector<uint32_t>& buckets : per_timer) {
+        timer_peaks += *std::max_element(buckets.begin(), buckets.end());
+    }
+
+    double mean = static_cast<double>(BENCH_ITERATIONS) / BUCKET_COUNT;
+
+    Jitter jitter = make(0);
+    Xoshiro256pp gen(12345);
+    resolution::rep sum = 0;
+    my_clock::time_point time_start = my_clock::now();
+    for (int i = 0; i < BENCH_DRAWS; ++i) {
+        sum += jitter.next(gen, INTERVAL_PERIOD).count();
+    }
+
+    duration elapsed = my_clock::now() - time_start;
+    // Keep the draws from being optimized away
+    volatile resolution::rep sink = sum;
+    (void)sink;
+
+    std::cout << std::left << std::setw(28) << std::setfill(' ') << name
+        << std::right << std::fixed << std::setprecision(2)
+        << std::setw(11) << static_cast<double>(tick_peaks) / BENCH_ITERATIONS
+        << std::setw(12) << timer_peaks / BENCH_TIMERS / mean
+        << std::setw(8) << static_cast<double>(elapsed.count()) / BENCH_DRAWS
+        << std::endl;
+}
+
+
+int main() {
+    std::cout << BENCH_TIMERS << " timers, " << BENCH_ITERATIONS
+        << " iterations, " << BUCKET_COUNT << " buckets of "
+        << (JITTER_MAX - JITTER_MIN) / BUCKET_COUNT / 1000 << " us."
+        << std::endl << std::endl;
+    std::cout << std::left << std::setw(28) << "Jitter" << std::right
+        << std::setw(11) << "Peak/tick" << std::setw(12) << "Peak/timer"
+        << std::setw(8) << "Draw" << std::endl
+        << std::setw(59) << "(ns)" << std::endl;
+    report<StaticJitter<JITTER_MIN, JITTER_MAX>>("Uniform random", [](uint64_t) {
+        return StaticJitter<JITTER_MIN, JITTER_MAX>();
+    });
+    report<GoldenRatioJitter<JITTER_MIN, JITTER_MAX>>("Golden ratio, per timer",
+                                                      [](uint64_t) {
+        return GoldenRatioJitter<JITTER_MIN, JITTER_MAX>();
+    });
+    report<GoldenRatioJitter<JITTER_MIN, JITTER_MAX>>("Golden ratio, seeded",
+                                                      [](uint64_t timer) {
+        return GoldenRatioJitter<JITTER_MIN, JITTER_MAX>(timer);
+    });
+    report<SharedGoldenRatioJitter<JITTER_MIN, JITTER_MAX>>(
+        "Golden ratio, shared", [](uint64_t) {
+        return SharedGoldenRatioJitter<JITTER_MIN, JITTER_MAX>();
+    });
+    return 0;
+}
@@ -0,0 +1,70 @@
+/* Run PeriodicTimer with its default sleeper, a condition variable waiting
+on steady_clock, and with clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME) on
+the absolute deadline, and print the distribution of how late each wakeup
+landed side by side. The runs alternate, so both see the same conditions.
+*/
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <thread>
+#include <iostream>
+#include <iomanip>
+
+#include "intervals.h"
+#include "histogram.h"
+#include "sleepers.h"
+#include "periodic_timer.h"
+#include "bench_util.h"
+
+// 1 s == 1,000,000,000 ns, per run
+#define BENCH_RUNTIME           resolution(1000000000)
+#define BENCH_ROUNDS            5
+
+
+#if defined(__linux__)
+
+template <typename Sleeper>
+void
+    run(LatencyHistogram& lateness) {
+    PeriodicTimer<JITTER_MIN, JITTER_MAX, Sleeper> timer;
+    QuietCout quiet;
+    timer.interval_current_start([](resolution) {});
+    std::this_thread::sleep_for(BENCH_RUNTIME);
+    timer.stop();
+    lateness.merge(timer.wakeup_lateness());
+}
+
+
+void
+    report(const char* name, const LatencyHistogram& lateness) {
+    std::cout << name << ": " << lateness.count() << " wakeups" << std::endl;
+    lateness.print(std::cout);
+    std::cout << std::endl;
+}
+
+
+int main() {
+    LatencyHistogram condition;
+    LatencyHistogram nanosleep;
+    for (int i = 0; i < BENCH_ROUNDS; ++i) {
+        run<ConditionSleeper>(condition);
+        run<NanosleepSleeper>(nanosleep);
+    }
+
+    std::cout << "How late each wakeup landed, over " << BENCH_ROUNDS
+        << " runs of "
+        << std::chrono::duration_cast<millisec>(BENCH_RUNTIME).count()
+        << " ms each." << std::endl << std::endl;
+    report("condition_variable::wait_until", condition);
+    report("clock_nanosleep(TIMER_ABSTIME)", nanosleep);
+    return 0;
+}
+
+#else
+
+int main() {
+    std::cout << "clock_nanosleep is only available on Linux." << std::endl;
+    return 0;
+}
+
+#endif
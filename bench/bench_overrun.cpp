@@ -0,0 +1,194 @@
+/* Run a 10 ms PeriodicTimer with each overrun policy on a virtual clock,
+with jitter near the top of the interval (9.8 to 9.9 ms), where every 100th
+do_it stalls for 10.15 ms. That often ends a stall in the next interval but
+past its jitter, so that slot can't be run on time either. For each policy,
+print the ticks it caught up, skipped and coalesced, and how late the latest
+call started. A stall this long leaves only the current slot overdue, so
+COALESCE has nothing to fold in here.
+
+Wakeups on the virtual clock are never late, so after a stall SKIP should
+only ever wait for a slot that's still ahead, and start every call on time.
+The bench checks that and fails if it doesn't.
+
+Then it runs SKIP and COALESCE with no jitter, where each do_it takes exactly
+one interval, so every call ends right when the next one is due. Neither
+should drop or fold in a slot that starts right then; the bench fails if one
+does.
+
+Last, the first do_it of a timer with no jitter stalls for five whole
+intervals, which leaves four slots overdue when it returns and a fifth
+starting right then. COALESCE should fold three of them into the call for
+the first, and make that one catch-up call before the fifth runs on time.
+BURST, with a limit of two, should run two back-to-back and skip the other
+two. The bench fails if either doesn't.
+*/
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+
+#include "intervals.h"
+#include "sleepers.h"
+#include "periodic_timer.h"
+#include "bench_util.h"
+
+#define BENCH_CALLS             10000
+#define STALL_EVERY             100
+#define STALL_TIME              microsec(10150)
+// Whole intervals the long stall lasts, and BURST's limit after it
+#define STALL_INTERVALS         5
+#define BURST_LIMIT             2
+
+
+/* What a timer did after its first do_it stalled for STALL_INTERVALS. */
+struct StallResult {
+    OverrunStats    stats;
+    // Calls that started when the stall ended, other than the one for the
+    // slot that began right then
+    uint64_t        catch_up_calls = 0;
+    // The most ticks one of those calls covered
+    uint64_t        most_ticks = 0;
+};
+
+
+//! @brief run the timer with policy until it has made BENCH_CALLS calls,
+// print its row, and return how late the latest call started.
+duration
+    run(const char* name, Overrun policy) {
+    PeriodicTimer<9800000, 9900000, VirtualSleeper> timer;
+    timer.set_overrun(policy, 1);
+    std::atomic<uint64_t> calls{0};
+    {
+        QuietCout quiet;
+        timer.interval_current_start([&](resolution) {
+            if (calls.fetch_add(1) % STALL_EVERY == STALL_EVERY - 1) {
+                timer.sleeper().advance(STALL_TIME);
+            }
+        });
+
+        while (calls.load() < BENCH_CALLS) {
+            std::this_thread::yield();
+        }
+
+        timer.stop();
+    }
+
+    const OverrunStats& stats = timer.overrun_stats();
+    duration latest = timer.lateness().largest();
+    std::cout << std::left << std::setw(12) << std::setfill(' ') << name
+        << std::right
+        << std::setw(11) << stats.caught_up_ticks
+        << std::setw(10) << stats.skipped_ticks
+        << std::setw(11) << stats.coalesced_ticks
+        << std::setw(12)
+        << std::chrono::duration_cast<microsec>(latest).count() << std::endl;
+    return latest;
+}
+
+
+//! @brief run a timer with no jitter whose do_it takes exactly one interval
+// with policy, and return the ticks it skipped or coalesced, which should be
+// none.
+uint64_t
+    run_exact(Overrun policy) {
+    PeriodicTimer<0, 0, VirtualSleeper> timer;
+    timer.set_overrun(policy, 1);
+    std::atomic<uint64_t> calls{0};
+    {
+        QuietCout quiet;
+        timer.interval_current_start([&](resolution) {
+            timer.sleeper().advance(INTERVAL_PERIOD);
+            ++calls;
+        });
+
+        while (calls.load() < BENCH_CALLS) {
+            std::this_thread::yield();
+        }
+
+        timer.stop();
+    }
+
+    const OverrunStats& stats = timer.overrun_stats();
+    return stats.skipped_ticks + stats.coalesced_ticks;
+}
+
+
+//! @brief run a timer with no jitter whose first do_it stalls for
+// STALL_INTERVALS with policy, and count what it did when the stall ended.
+StallResult
+    run_stall(Overrun policy, uint64_t max_catch_up) {
+    PeriodicTimer<0, 0, VirtualSleeper> timer;
+    timer.set_overrun(policy, max_catch_up);
+    StallResult result;
+    std::atomic<uint64_t> calls{0};
+    my_clock::time_point stall_end;
+    uint64_t calls_at_end = 0;
+    {
+        QuietCout quiet;
+        timer.interval_current_start_ticks([&](resolution, uint64_t ticks) {
+            my_clock::time_point now = timer.sleeper().now();
+            if (calls.load() == 0) {
+                stall_end = now + INTERVAL_PERIOD * STALL_INTERVALS;
+                timer.sleeper().advance(INTERVAL_PERIOD * STALL_INTERVALS);
+            } else if (now == stall_end) {
+                ++calls_at_end;
+                result.most_ticks = std::max(result.most_ticks, ticks);
+            }
+
+            ++calls;
+        });
+
+        while (calls.load() < 2 * STALL_INTERVALS) {
+            std::this_thread::yield();
+        }
+
+        timer.stop();
+    }
+
+    result.stats = timer.overrun_stats();
+    result.catch_up_calls = calls_at_end - 1;
+    return result;
+}
+
+
+int main() {
+    std::cout << "Policy       Caught up   Skipped  Coalesced  Latest (us)"
+        << std::endl;
+    run("CATCH_UP", Overrun::CATCH_UP);
+    duration skip_latest = run("SKIP", Overrun::SKIP);
+    run("BURST", Overrun::BURST);
+    run("COALESCE", Overrun::COALESCE);
+
+    bool on_time = skip_latest == duration(0);
+    std::cout << std::endl << "SKIP started every call on time: "
+        << (on_time ? "yes" : "NO") << std::endl;
+
+    bool kept = run_exact(Overrun::SKIP) == 0 && run_exact(Overrun::COALESCE) == 0;
+    std::cout << "SKIP and COALESCE kept a slot that starts right away: "
+        << (kept ? "yes" : "NO") << std::endl;
+
+    // The first slot was run, the next STALL_INTERVALS - 1 are overdue
+    const uint64_t overdue = STALL_INTERVALS - 1;
+    StallResult coalesce = run_stall(Overrun::COALESCE, 1);
+    bool folded = coalesce.stats.coalesced_ticks == overdue - 1
+        && coalesce.catch_up_calls == 1 && coalesce.most_ticks == overdue;
+    std::cout << "COALESCE folded " << coalesce.stats.coalesced_ticks
+        << " of " << overdue << " overdue ticks into "
+        << coalesce.catch_up_calls << " catch-up call after a stall of "
+        << STALL_INTERVALS << " intervals: " << (folded ? "yes" : "NO")
+        << std::endl;
+
+    StallResult burst = run_stall(Overrun::BURST, BURST_LIMIT);
+    bool capped = burst.catch_up_calls == BURST_LIMIT
+        && burst.stats.caught_up_ticks == BURST_LIMIT
+        && burst.stats.skipped_ticks == overdue - BURST_LIMIT;
+    std::cout << "BURST caught up " << burst.catch_up_calls << " and skipped "
+        << burst.stats.skipped_ticks << " of " << overdue
+        << " overdue ticks with a limit of " << BURST_LIMIT << ": "
+        << (capped ? "yes" : "NO") << std::endl;
+    return on_time && kept && folded && capped ? 0 : 1;
+}
@@ -0,0 +1,63 @@
+/* Compare how precisely PeriodicTimer starts its iterations when it only
+sleeps, and in precision mode, where it sleeps until a guard window before
+each deadline and spins the rest of the way. For each mode, print a histogram
+of how late the iterations started and the CPU time it used.
+*/
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <thread>
+#include <iostream>
+#include <iomanip>
+
+#include "intervals.h"
+#include "platform.h"
+#include "histogram.h"
+#include "periodic_timer.h"
+#include "bench_util.h"
+
+// 3 s == 3,000,000,000 ns
+#define BENCH_RUNTIME           resolution(3000000000)
+
+
+void
+    measure(const char* name, resolution guard) {
+    PeriodicTimer<JITTER_MIN, JITTER_MAX> timer;
+    timer.set_precision(guard);
+
+    duration cpu_start = process_cpu_time();
+    my_clock::time_point time_start = my_clock::now();
+    {
+        QuietCout quiet;
+        timer.interval_current_start([](resolution) {});
+        std::this_thread::sleep_for(BENCH_RUNTIME);
+        timer.stop();
+    }
+
+    duration elapsed = my_clock::now() - time_start;
+    duration cpu_time = process_cpu_time() - cpu_start;
+    std::cout << name << ": " << timer.lateness().count()
+        << " iterations, CPU " << std::fixed << std::setprecision(1)
+        << static_cast<double>(cpu_time.count())
+            / static_cast<double>(elapsed.count()) * 1000.0
+        << " ms/s" << std::endl;
+    timer.lateness().print(std::cout);
+    std::cout << std::endl;
+}
+
+
+int main() {
+    std::cout << "Each run lasts "
+        << std::chrono::duration_cast<millisec>(BENCH_RUNTIME).count()
+        << " ms with a "
+        << std::chrono::duration_cast<millisec>(INTERVAL_PERIOD).count()
+        << " ms interval. The histograms show how late iterations started."
+        << std::endl << std::endl;
+
+    measure("Sleep only", resolution(0));
+    // 20 us, 100 us and 500 us guard windows
+    measure("Spin 20 us", resolution(20000));
+    measure("Spin 100 us", resolution(100000));
+    measure("Spin 500 us", resolution(500000));
+    return 0;
+}
@@ -0,0 +1,117 @@
+/* Compare the generators in random.h with std::mt19937: the time to seed one
+from std::random_device, the time per raw draw, the time per jitter draw in
+[JITTER_MIN, JITTER_MAX], and the memory each takes, alone and in a
+PeriodicTimer. A timer's histograms are only allocated once it runs, so the
+timer is shown both idle (its size) and after a run with its statistics on
+and off.
+
+mt19937's jitter is drawn both with std::uniform_int_distribution, the way
+the timers used to, and with uniform_in().
+*/
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <iomanip>
+
+#include "intervals.h"
+#include "random.h"
+#include "periodic_timer.h"
+#include "bench_util.h"
+
+#define BENCH_DRAWS             10000000
+#define BENCH_SEEDS             1000
+
+
+//! @brief the average time per call of draw, which returns a number to sum.
+template <typename Draw>
+double
+    time_per(int count, Draw draw) {
+    uint64_t sum = 0;
+    my_clock::time_point time_start = my_clock::now();
+    for (int i = 0; i < count; ++i) {
+        sum += static_cast<uint64_t>(draw());
+    }
+
+    duration elapsed = my_clock::now() - time_start;
+    // Keep the draws from being optimized away
+    volatile uint64_t sink = sum;
+    (void)sink;
+    return static_cast<double>(elapsed.count()) / count;
+}
+
+
+//! @brief the bytes a timer with Generator takes after a run of one
+// iteration, with its statistics on or off.
+template <typename Generator>
+size_t
+    run_footprint(bool statistics) {
+    PeriodicTimer<JITTER_MIN, JITTER_MAX, ConditionSleeper, Generator> timer;
+    timer.set_statistics(statistics);
+    {
+        QuietCout quiet;
+        timer.doItCounted([](resolution) {}, 1);
+    }
+
+    return sizeof(timer) + timer.lateness().allocated_bytes()
+        + timer.execution_times().allocated_bytes()
+        + timer.wakeup_lateness().allocated_bytes();
+}
+
+
+template <typename Generator>
+void
+    report(const char* name, bool standard_distribution = false) {
+    double seed = time_per(BENCH_SEEDS, []() {
+        Generator gen(random_seed());
+        return gen();
+    });
+
+    Generator gen(random_seed());
+    double raw = time_per(BENCH_DRAWS, [&]() {
+        return gen();
+    });
+
+    double jitter;
+    if (standard_distribution) {
+        std::uniform_int_distribution<resolution::rep> distribution(JITTER_MIN,
+                                                                    JITTER_MAX);
+        jitter = time_per(BENCH_DRAWS, [&]() {
+            return distribution(gen);
+        });
+    } else {
+        jitter = time_per(BENCH_DRAWS, [&]() {
+            return uniform_in(gen, JITTER_MIN, JITTER_MAX);
+        });
+    }
+
+    // Before printing, since the timer prints its own statistics
+    size_t running = run_footprint<Generator>(true);
+    size_t running_quiet = run_footprint<Generator>(false);
+    std::cout << std::left << std::setw(24) << std::setfill(' ') << name
+        << std::right << std::fixed << std::setprecision(1)
+        << std::setw(9) << seed
+        << std::setw(9) << raw
+        << std::setw(9) << jitter
+        << std::setw(9) << sizeof(Generator)
+        << std::setw(9)
+        << sizeof(PeriodicTimer<JITTER_MIN, JITTER_MAX, ConditionSleeper,
+                                Generator>)
+        << std::setw(10) << running
+        << std::setw(10) << running_quiet
+        << std::endl;
+}
+
+
+int main() {
+    std::cout << "Times are in ns, sizes in bytes." << std::endl << std::endl;
+    std::cout << "Generator                    Seed      Raw   Jitter"
+        "     Size    Timer   Running  No stats" << std::endl;
+    report<std::mt19937>("mt19937 + distribution", true);
+    report<std::mt19937>("mt19937 + uniform_in");
+    report<Xoshiro256pp>("xoshiro256++");
+    report<Pcg32>("pcg32");
+    report<Wyrand>("wyrand");
+    return 0;
+}
@@ -0,0 +1,74 @@
+/* A cyclictest-style comparison of PeriodicTimer with a normal timer thread
+and with a real-time one (SCHED_FIFO, locked memory, pinned to a CPU). Both
+run a 1 ms interval with no jitter, so the lateness is all wakeup latency.
+
+The real-time settings need privileges. Whatever can't be applied is listed,
+and that run goes ahead with the rest.
+*/
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <thread>
+#include <iostream>
+#include <iomanip>
+
+#include "intervals.h"
+#include "platform.h"
+#include "histogram.h"
+#include "real_time.h"
+#include "periodic_timer.h"
+#include "bench_util.h"
+
+// 5 s == 5,000,000,000 ns
+#define BENCH_RUNTIME           resolution(5000000000)
+// 1 ms == 1,000,000 ns, cyclictest's default
+#define BENCH_INTERVAL          resolution(1000000)
+#define BENCH_PRIORITY          80
+
+
+void
+    measure(const char* name, const RealTimeConfig& config) {
+    PeriodicTimer<0, 0> timer(BENCH_INTERVAL);
+    timer.set_real_time(config);
+    {
+        QuietCout quiet;
+        timer.interval_current_start([](resolution) {});
+        std::this_thread::sleep_for(BENCH_RUNTIME);
+        timer.stop();
+    }
+
+    const LatencyHistogram& lateness = timer.lateness();
+    std::cout << std::left << std::setw(8) << std::setfill(' ') << name
+        << std::right
+        << " C:" << std::setw(7) << lateness.count()
+        << " Min:" << std::setw(7) << std::chrono::duration_cast<microsec>(
+            lateness.smallest()).count()
+        << " Avg:" << std::setw(7) << std::chrono::duration_cast<microsec>(
+            lateness.average()).count()
+        << " Max:" << std::setw(7) << std::chrono::duration_cast<microsec>(
+            lateness.largest()).count()
+        << " P99.9:" << std::setw(7) << std::chrono::duration_cast<microsec>(
+            lateness.percentile(0.999)).count() << std::endl;
+
+    for (const std::string& failure : timer.real_time_status().failures) {
+        std::cout << "         not applied: " << failure << std::endl;
+    }
+}
+
+
+int main() {
+    std::cout << "Wakeup lateness in us over "
+        << std::chrono::duration_cast<millisec>(BENCH_RUNTIME).count()
+        << " ms with a "
+        << std::chrono::duration_cast<microsec>(BENCH_INTERVAL).count()
+        << " us interval." << std::endl << std::endl;
+
+    measure("normal", RealTimeConfig());
+
+    RealTimeConfig real_time;
+    real_time.fifo_priority = BENCH_PRIORITY;
+    real_time.lock_memory = true;
+    real_time.cpu = static_cast<int>(cpu_count()) - 1;
+    measure("rt", real_time);
+    return 0;
+}
@@ -0,0 +1,101 @@
+/* What it costs to set the jitter at run time instead of compile time.
+
+First, the time per jitter draw with StaticJitter (what PeriodicTimer uses),
+with RuntimeJitter in each shape, and with RuntimeJitter while another thread
+changes its range every millisecond. Then the time per iteration of
+doItCounted with no interval and no jitter, so the loop itself is all that's
+measured, with PeriodicTimer and RuntimePeriodicTimer.
+*/
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <iostream>
+#include <iomanip>
+
+#include "intervals.h"
+#include "jitter.h"
+#include "periodic_timer.h"
+#include "bench_util.h"
+
+#define BENCH_DRAWS             10000000
+#define BENCH_ITERATIONS        200000
+
+
+//! @brief the average time of one jitter.next() call.
+template <typename Jitter>
+double
+    time_draws(Jitter& jitter) {
+    std::mt19937 gen(12345);
+    resolution::rep sum = 0;
+    my_clock::time_point time_start = my_clock::now();
+    for (int i = 0; i < BENCH_DRAWS; ++i) {
+        sum += jitter.next(gen, INTERVAL_PERIOD).count();
+    }
+
+    duration elapsed = my_clock::now() - time_start;
+    // Keep the draws from being optimized away
+    volatile resolution::rep sink = sum;
+    (void)sink;
+    return static_cast<double>(elapsed.count()) / BENCH_DRAWS;
+}
+
+
+//! @brief the average time of one doItCounted iteration.
+template <typename Timer>
+double
+    time_iterations(Timer& timer) {
+    QuietCout quiet;
+    my_clock::time_point time_start = my_clock::now();
+    timer.doItCounted([](resolution) {}, BENCH_ITERATIONS);
+    duration elapsed = my_clock::now() - time_start;
+    return static_cast<double>(elapsed.count()) / BENCH_ITERATIONS;
+}
+
+
+void
+    report(const char* name, double ns) {
+    std::cout << "  " << std::left << std::setw(24) << std::setfill(' ')
+        << name << std::right << std::fixed << std::setprecision(1)
+        << std::setw(8) << ns << " ns" << std::endl;
+}
+
+
+int main() {
+    std::cout << "Per jitter draw, with mt19937:" << std::endl;
+    StaticJitter<JITTER_MIN, JITTER_MAX> fixed;
+    report("static", time_draws(fixed));
+
+    RuntimeJitter uniform;
+    report("runtime uniform", time_draws(uniform));
+
+    RuntimeJitter normal(resolution(JITTER_MIN), resolution(JITTER_MAX),
+                         JitterShape::NORMAL);
+    report("runtime normal", time_draws(normal));
+
+    RuntimeJitter changing;
+    std::atomic<bool> is_running(true);
+    std::thread changer([&]() {
+        bool wide = false;
+        while (is_running.load()) {
+            changing.set(resolution(JITTER_MIN),
+                         resolution(wide ? JITTER_MAX : JITTER_MAX / 2));
+            wide = !wide;
+            std::this_thread::sleep_for(millisec(1));
+        }
+    });
+    report("runtime, changing", time_draws(changing));
+    is_running.store(false);
+    changer.join();
+
+    std::cout << std::endl << "Per doItCounted iteration:" << std::endl;
+    PeriodicTimer<0, 0> static_timer(resolution(0));
+    report("PeriodicTimer", time_iterations(static_timer));
+
+    RuntimePeriodicTimer<> runtime_timer(resolution(0));
+    runtime_timer.jitter().set(resolution(0), resolution(0));
+    report("RuntimePeriodicTimer", time_iterations(runtime_timer));
+    return 0;
+}
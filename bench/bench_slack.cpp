@@ -0,0 +1,103 @@
+/* Run timers that only need coarse precision with a range of slack values,
+and report how many times per second the scheduler thread wakes up, how many
+expirations shared a wakeup with another one, and how late the callbacks ran
+compared to their deadlines before slack rounded them.
+
+The timers' jitter spans the whole interval, and the spread column shows how
+many distinct 1 ms windows of the interval the callbacks ran in, so you can
+see how much of the jitter's spread a slack keeps.
+*/
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <thread>
+#include <iostream>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+#include "intervals.h"
+#include "platform.h"
+#include "scheduler.h"
+
+// 3 s == 3,000,000,000 ns
+#define BENCH_RUNTIME           resolution(3000000000)
+// 100 ms == 100,000,000 ns
+#define BENCH_INTERVAL          resolution(100000000)
+#define BENCH_TIMERS            1000
+// Also ask the kernel for this much slack on the scheduler thread's own waits
+#define BENCH_THREAD_SLACK      resolution(50000)
+
+
+void
+    measure(resolution slack, bool thread_slack) {
+    // The heap fires timers on their exact deadline, so without slack every
+    // deadline is a wakeup of its own.
+    HeapScheduler scheduler;
+    if (thread_slack) {
+        scheduler.set_thread_slack(BENCH_THREAD_SLACK);
+    }
+
+    // Which 1 ms windows of the interval the callbacks ran in
+    const resolution window(1000000);
+    std::vector<bool> windows(static_cast<size_t>(BENCH_INTERVAL / window));
+    my_clock::time_point time_start = my_clock::now();
+    for (int i = 0; i < BENCH_TIMERS; ++i) {
+        scheduler.add(BENCH_INTERVAL, resolution(0), BENCH_INTERVAL - window,
+                      [&](resolution) {
+            resolution offset = (my_clock::now() - time_start) % BENCH_INTERVAL;
+            windows[static_cast<size_t>(offset / window)] = true;
+        }, slack);
+    }
+
+    duration cpu_start = process_cpu_time();
+    scheduler.start();
+    std::this_thread::sleep_for(BENCH_RUNTIME);
+    scheduler.stop();
+    duration elapsed = my_clock::now() - time_start;
+    duration cpu_time = process_cpu_time() - cpu_start;
+
+    size_t spread = 0;
+    for (bool used : windows) {
+        spread += used ? 1 : 0;
+    }
+
+    SchedulerStats stats = scheduler.stats();
+    double seconds = static_cast<double>(elapsed.count()) / 1e9;
+    std::cout << std::setw(7) << std::setfill(' ')
+        << std::chrono::duration_cast<microsec>(slack).count()
+        << std::setw(8) << (thread_slack ? "yes" : "no")
+        << std::fixed << std::setprecision(0)
+        << std::setw(12) << static_cast<double>(stats.wakeups) / seconds
+        << std::setw(12) << static_cast<double>(stats.merged_expirations) / seconds
+        << std::setw(10) << std::chrono::duration_cast<microsec>(
+            stats.dispatch_latency.average()).count()
+        << std::setw(10) << std::chrono::duration_cast<microsec>(
+            stats.dispatch_latency.largest()).count()
+        << std::setw(8) << spread
+        << std::setprecision(1)
+        << std::setw(12) << static_cast<double>(cpu_time.count())
+            / static_cast<double>(elapsed.count()) * 1000.0 << std::endl;
+}
+
+
+int main() {
+    // 0, 100 us, 1 ms, 5 ms and 20 ms
+    const resolution slacks[] = {
+        resolution(0), resolution(100000), resolution(1000000),
+        resolution(5000000), resolution(20000000)
+    };
+
+    std::cout << BENCH_TIMERS << " timers, "
+        << std::chrono::duration_cast<millisec>(BENCH_INTERVAL).count()
+        << " ms interval. Slack and lateness are in us, spread is in 1 ms"
+        " windows." << std::endl << std::endl;
+    std::cout << "  Slack  Thread   Wakeups/s    Merged/s  Avg late  Max late"
+        "  Spread  CPU (ms/s)" << std::endl;
+    for (resolution slack : slacks) {
+        measure(slack, false);
+    }
+
+    measure(resolution(1000000), true);
+    return 0;
+}
@@ -0,0 +1,107 @@
+/* Measure how long PeriodicTimer::stop() takes to return, for intervals from
+1 ms to 10 s. stop() is called at a random point in an interval, while the
+timer thread is waiting for its next iteration.
+
+For comparison, the same loop sleeping in sleep_until, with a run flag that
+is only checked after each sleep, which is how the timer used to stop.
+*/
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <future>
+#include <iostream>
+#include <iomanip>
+
+#include "intervals.h"
+#include "periodic_timer.h"
+#include "bench_util.h"
+
+#define BENCH_STOPS             5
+
+
+//! @brief wait a random part of one interval, so stop() is called somewhere
+// in the middle of the timer's wait.
+void
+    wait_into_interval(resolution interval, std::mt19937& gen) {
+    std::uniform_int_distribution<resolution::rep> distribution(
+        interval.count() / 10, interval.count() * 9 / 10);
+    std::this_thread::sleep_for(interval + resolution(distribution(gen)));
+}
+
+
+DurationStats
+    measure_timer(resolution interval, std::mt19937& gen) {
+    DurationStats result;
+    for (int i = 0; i < BENCH_STOPS; ++i) {
+        PeriodicTimer<0, 0> timer(interval);
+        QuietCout quiet;
+        timer.interval_current_start([](resolution) {});
+        wait_into_interval(interval, gen);
+
+        my_clock::time_point time_stop = my_clock::now();
+        timer.stop();
+        result.insert(my_clock::now() - time_stop);
+    }
+
+    return result;
+}
+
+
+DurationStats
+    measure_sleep_until(resolution interval, std::mt19937& gen) {
+    DurationStats result;
+    for (int i = 0; i < BENCH_STOPS; ++i) {
+        std::atomic<bool> is_running(true);
+        std::future<void> pending = std::async(std::launch::async, [&]() {
+            my_clock::time_point time_do_it = my_clock::now();
+            while (is_running.load()) {
+                time_do_it += interval;
+                std::this_thread::sleep_until(time_do_it);
+            }
+        });
+        wait_into_interval(interval, gen);
+
+        my_clock::time_point time_stop = my_clock::now();
+        is_running.store(false);
+        pending.get();
+        result.insert(my_clock::now() - time_stop);
+    }
+
+    return result;
+}
+
+
+void
+    report(const char* name, resolution interval, const DurationStats& stats) {
+    std::cout << std::setw(9) << std::setfill(' ')
+        << std::chrono::duration_cast<millisec>(interval).count() << "  "
+        << std::left << std::setw(12) << name << std::right
+        << std::setw(12) << std::chrono::duration_cast<microsec>(
+            stats.average()).count()
+        << std::setw(12) << std::chrono::duration_cast<microsec>(
+            stats.largest()).count() << std::endl;
+}
+
+
+int main() {
+    // 1 ms, 10 ms, 100 ms, 1 s and 10 s
+    const resolution intervals[] = {
+        resolution(1000000), resolution(10000000), resolution(100000000),
+        resolution(1000000000), resolution(10000000000)
+    };
+    std::random_device seed_generator;
+    std::mt19937 gen(seed_generator());
+
+    std::cout << "Intervals are in ms, stop latency in us, " << BENCH_STOPS
+        << " stops per interval." << std::endl << std::endl;
+    std::cout << " Interval  Wait           Average     Longest" << std::endl;
+    for (resolution interval : intervals) {
+        report("condition", interval, measure_timer(interval, gen));
+        report("sleep_until", interval, measure_sleep_until(interval, gen));
+    }
+
+    return 0;
+}
@@ -0,0 +1,218 @@
+/* Count the system calls it takes to fire a timer when every timer has its
+own thread sleeping in sleep_until (the way PeriodicTimer::doItTimed works),
+and when UringScheduler fires them all from one thread with io_uring.
+
+A sleep_until thread makes one clock_nanosleep call per expiration; reading
+the clock is done in the vDSO and isn't a system call. UringScheduler makes
+one io_uring_enter call per round, and a round re-arms and collects every
+timer that expired since the last one, so the more timers there are, the fewer
+calls each expiration costs. HeapScheduler makes one wait per wakeup, and
+is the yardstick for lateness: the run fails if UringScheduler's timers are on
+average more than LATENESS_RATIO times as late as the heap's.
+*/
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <random>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+#include "intervals.h"
+#include "platform.h"
+#include "histogram.h"
+#include "uring_scheduler.h"
+
+// 2 s == 2,000,000,000 ns
+#define BENCH_RUNTIME           resolution(2000000000)
+// 100 ms == 100,000,000 ns, so there are plenty of expirations per run
+#define BENCH_INTERVAL          resolution(100000000)
+// How many times later than HeapScheduler UringScheduler may be on average.
+// Lateness under 100 us passes regardless, so scheduling noise on a handful
+// of timers doesn't fail the run.
+#define LATENESS_RATIO          4
+#define LATENESS_FLOOR          resolution(100000)
+
+
+struct SyscallResult {
+    uint64_t        expirations = 0;
+    double          syscalls_per_expiration = 0.0;
+    LatencyHistogram lateness;
+    duration        cpu_time = duration(0);
+    duration        elapsed = duration(0);
+};
+
+
+//! @brief one thread per timer, each sleeping until its next deadline.
+SyscallResult
+    measure_threads(size_t timers) {
+    SyscallResult result;
+    std::atomic<bool> is_running(true);
+    std::atomic<uint64_t> expirations(0);
+    std::atomic<uint64_t> sleeps(0);
+    std::mutex mutex;
+    std::vector<std::thread> threads;
+
+    duration cpu_start = process_cpu_time();
+    my_clock::time_point time_start = my_clock::now();
+    for (size_t i = 0; i < timers; ++i) {
+        threads.emplace_back([&]() {
+            LatencyHistogram lateness;
+            std::random_device seed_generator;
+            std::mt19937 gen(seed_generator());
+            std::uniform_int_distribution<> distribution(JITTER_MIN,
+                                                         JITTER_MAX);
+            uint64_t own_sleeps = 0;
+            uint64_t own_expirations = 0;
+            my_clock::time_point interval_current_start = my_clock::now();
+            while (is_running.load()) {
+                my_clock::time_point time_do_it = interval_current_start
+                    + resolution(distribution(gen));
+                if (my_clock::now() < time_do_it) {
+                    std::this_thread::sleep_until(time_do_it);
+                    ++own_sleeps;
+                }
+
+                lateness.insert(my_clock::now() - time_do_it);
+                ++own_expirations;
+                interval_current_start += BENCH_INTERVAL;
+            }
+
+            sleeps += own_sleeps;
+            expirations += own_expirations;
+            std::lock_guard<std::mutex> lock(mutex);
+            result.lateness.merge(lateness);
+        });
+    }
+
+    std::this_thread::sleep_for(BENCH_RUNTIME);
+    is_running.store(false);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    result.elapsed = my_clock::now() - time_start;
+    result.cpu_time = process_cpu_time() - cpu_start;
+    result.expirations = expirations.load();
+    if (result.expirations != 0) {
+        result.syscalls_per_expiration = static_cast<double>(sleeps.load())
+            / static_cast<double>(result.expirations);
+    }
+
+    return result;
+}
+
+
+//! @brief one scheduler thread for all of the timers. For HeapScheduler,
+// the calls are its waits.
+template <typename SchedulerType>
+SyscallResult
+    measure_scheduler(SchedulerType& scheduler, size_t timers) {
+    SyscallResult result;
+
+    duration cpu_start = process_cpu_time();
+    my_clock::time_point time_start = my_clock::now();
+    for (size_t i = 0; i < timers; ++i) {
+        scheduler.add(BENCH_INTERVAL, resolution(JITTER_MIN),
+                      resolution(JITTER_MAX), [](resolution) {});
+    }
+
+    scheduler.start();
+    std::this_thread::sleep_for(BENCH_RUNTIME);
+    result.expirations = scheduler.stop();
+
+    result.elapsed = my_clock::now() - time_start;
+    result.cpu_time = process_cpu_time() - cpu_start;
+    SchedulerStats stats = scheduler.stats();
+    result.lateness = stats.dispatch_latency;
+    if (result.expirations != 0) {
+        result.syscalls_per_expiration = static_cast<double>(stats.wakeups)
+            / static_cast<double>(result.expirations);
+    }
+
+    return result;
+}
+
+
+//! @brief the same, counting io_uring_enter calls.
+SyscallResult
+    measure_scheduler(UringScheduler& scheduler, size_t timers) {
+    SyscallResult result = measure_scheduler<UringScheduler>(scheduler, timers);
+    result.syscalls_per_expiration = scheduler.syscalls_per_expiration();
+    return result;
+}
+
+
+void
+    report(const char* name, size_t timers, const SyscallResult& result) {
+    double cpu_per_second = static_cast<double>(result.cpu_time.count())
+        / static_cast<double>(result.elapsed.count()) * 1000.0;
+    std::cout << std::setw(7) << std::setfill(' ') << timers << "  "
+        << std::left << std::setw(11) << name << std::right
+        << std::setw(12) << result.expirations
+        << std::fixed << std::setprecision(3)
+        << std::setw(12) << result.syscalls_per_expiration
+        << std::setw(10) << std::chrono::duration_cast<microsec>(
+            result.lateness.average()).count()
+        << std::setprecision(1)
+        << std::setw(12) << cpu_per_second << std::endl;
+}
+
+
+int main() {
+    const size_t counts[] = {10, 100, 1000, 10000};
+
+    {
+        UringScheduler probe;
+        if (!probe.uses_io_uring()) {
+            std::cout << "io_uring isn't available here, so there's nothing to"
+                " compare." << std::endl;
+            return 0;
+        }
+    }
+
+    std::cout << "Each run lasts "
+        << std::chrono::duration_cast<millisec>(BENCH_RUNTIME).count()
+        << " ms with a "
+        << std::chrono::duration_cast<millisec>(BENCH_INTERVAL).count()
+        << " ms interval. Lateness is in us, CPU is ms of CPU time per second."
+        << std::endl << std::endl;
+    std::cout << " Timers  Waiter        Expirations  Calls/exp  Avg late"
+        "  CPU (ms/s)" << std::endl;
+
+    bool on_time = true;
+    for (size_t timers : counts) {
+        // Ten thousand threads is more than some systems allow
+        if (timers <= 1000) {
+            report("sleep_until", timers, measure_threads(timers));
+        }
+
+        HeapScheduler heap;
+        SyscallResult heap_result = measure_scheduler(heap, timers);
+        report("heap", timers, heap_result);
+
+        UringScheduler scheduler;
+        SyscallResult uring_result = measure_scheduler(scheduler, timers);
+        report("io_uring", timers, uring_result);
+
+        duration heap_late = heap_result.lateness.average();
+        duration uring_late = uring_result.lateness.average();
+        if (uring_late > LATENESS_FLOOR
+            && uring_late > heap_late * LATENESS_RATIO) {
+            std::cout << "io_uring timers are "
+                << std::chrono::duration_cast<microsec>(uring_late).count()
+                << " us late on average, more than " << LATENESS_RATIO
+                << " times the heap's "
+                << std::chrono::duration_cast<microsec>(heap_late).count()
+                << " us" << std::endl;
+            on_time = false;
+        }
+    }
+
+    std::cout << std::endl << "io_uring kept up with the heap: "
+        << (on_time ? "yes" : "NO") << std::endl;
+    return on_time ? 0 : 1;
+}
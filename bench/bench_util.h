@@ -0,0 +1,21 @@
+#pragma once
+
+#include <iostream>
+#include <sstream>
+
+
+//! @brief discard what's written to std::cout while it's in scope, since
+// PeriodicTimer prints its statistics at the end of every run.
+class QuietCout {
+    std::ostringstream  sink_;
+    std::streambuf*     saved_;
+
+public:
+    QuietCout()
+        : saved_(std::cout.rdbuf(sink_.rdbuf())) {
+    }
+
+    ~QuietCout() {
+        std::cout.rdbuf(saved_);
+    }
+};
@@ -0,0 +1,70 @@
+/* Simulate an hour of a 10 ms PeriodicTimer on a virtual clock, and report
+how long the simulation really took next to the schedule it produced.
+
+do_it is modeled as running for an exponentially distributed time with a
+mean of 300 us, and each wakeup as an exponentially distributed 50 us late,
+with one wakeup in 1000 stalled for 20 ms, which costs a few missed
+intervals.
+*/
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <iomanip>
+
+#include "intervals.h"
+#include "histogram.h"
+#include "sleepers.h"
+#include "periodic_timer.h"
+#include "bench_util.h"
+
+// 1 hour of 10 ms intervals
+#define BENCH_ITERATIONS        360000
+
+
+int main() {
+    PeriodicTimer<JITTER_MIN, JITTER_MAX, VirtualSleeper> timer;
+    std::mt19937 gen(12345);
+    std::exponential_distribution<double> run_time(1.0 / 300000);
+    std::exponential_distribution<double> late(1.0 / 50000);
+    std::bernoulli_distribution stall(0.001);
+    timer.sleeper().set_lateness([&]() {
+        double ns = late(gen) + (stall(gen) ? 20000000.0 : 0.0);
+        return duration(static_cast<duration::rep>(ns));
+    });
+
+    my_clock::time_point time_start = my_clock::now();
+    {
+        QuietCout quiet;
+        timer.doItCounted([&](resolution) {
+            timer.sleeper().advance(
+                duration(static_cast<duration::rep>(run_time(gen))));
+        }, BENCH_ITERATIONS);
+    }
+    duration elapsed = my_clock::now() - time_start;
+
+    const LatencyHistogram& lateness = timer.lateness();
+    std::cout << "Simulated " << BENCH_ITERATIONS << " iterations, "
+        << std::chrono::duration_cast<std::chrono::seconds>(
+            timer.runtime()).count()
+        << " s of schedule, in "
+        << std::chrono::duration_cast<millisec>(elapsed).count() << " ms ("
+        << std::fixed << std::setprecision(0)
+        << static_cast<double>(elapsed.count()) / BENCH_ITERATIONS
+        << " ns per iteration)." << std::endl << std::endl;
+    std::cout << "Execution time avg/p99:  "
+        << std::chrono::duration_cast<microsec>(
+            timer.execution_times().average()).count() << " / "
+        << std::chrono::duration_cast<microsec>(
+            timer.execution_times().percentile(0.99)).count() << " us"
+        << std::endl;
+    std::cout << "Lateness avg/p99/p99.9:  "
+        << std::chrono::duration_cast<microsec>(lateness.average()).count()
+        << " / " << std::chrono::duration_cast<microsec>(
+            lateness.percentile(0.99)).count()
+        << " / " << std::chrono::duration_cast<microsec>(
+            lateness.percentile(0.999)).count() << " us" << std::endl;
+    lateness.print(std::cout);
+    return 0;
+}
@@ -0,0 +1,146 @@
+/* Compare how late timers wake up, and how much CPU it costs, when every
+timer has its own thread sleeping in sleep_until (the way
+PeriodicTimer::doItTimed works) and when one scheduler thread serves all of
+the timers, sleeping on a condition variable or, on Linux, in epoll_wait on a
+timerfd.
+
+The schedulers use the deadline heap, so their timers fire on the exact
+deadline just like the sleep_until threads, rather than on a wheel tick.
+Lateness is the time from a timer's deadline until its callback starts.
+*/
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <random>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+#include "intervals.h"
+#include "platform.h"
+#include "histogram.h"
+#include "scheduler.h"
+
+// 2 s == 2,000,000,000 ns
+#define BENCH_RUNTIME           resolution(2000000000)
+
+
+struct WakeupResult {
+    LatencyHistogram lateness;
+    duration        cpu_time = duration(0);
+    duration        elapsed = duration(0);
+};
+
+
+//! @brief one thread per timer, each sleeping until its next deadline.
+WakeupResult
+    measure_threads(size_t timers) {
+    WakeupResult result;
+    std::atomic<bool> is_running(true);
+    std::mutex mutex;
+    std::vector<std::thread> threads;
+
+    duration cpu_start = process_cpu_time();
+    my_clock::time_point time_start = my_clock::now();
+    for (size_t i = 0; i < timers; ++i) {
+        threads.emplace_back([&]() {
+            LatencyHistogram lateness;
+            std::random_device seed_generator;
+            std::mt19937 gen(seed_generator());
+            std::uniform_int_distribution<> distribution(JITTER_MIN,
+                                                         JITTER_MAX);
+            my_clock::time_point interval_current_start = my_clock::now();
+            while (is_running.load()) {
+                my_clock::time_point time_do_it = interval_current_start
+                    + resolution(distribution(gen));
+                if (my_clock::now() < time_do_it) {
+                    std::this_thread::sleep_until(time_do_it);
+                }
+
+                lateness.insert(my_clock::now() - time_do_it);
+                interval_current_start += INTERVAL_PERIOD;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            result.lateness.merge(lateness);
+        });
+    }
+
+    std::this_thread::sleep_for(BENCH_RUNTIME);
+    is_running.store(false);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    result.elapsed = my_clock::now() - time_start;
+    result.cpu_time = process_cpu_time() - cpu_start;
+    return result;
+}
+
+
+//! @brief one scheduler thread for all of the timers.
+template <typename Waiter>
+WakeupResult
+    measure_scheduler(size_t timers) {
+    WakeupResult result;
+    Scheduler<DeadlineHeap, Waiter> scheduler;
+
+    duration cpu_start = process_cpu_time();
+    my_clock::time_point time_start = my_clock::now();
+    for (size_t i = 0; i < timers; ++i) {
+        scheduler.add(INTERVAL_PERIOD, resolution(JITTER_MIN),
+                      resolution(JITTER_MAX), [](resolution) {});
+    }
+
+    scheduler.start();
+    std::this_thread::sleep_for(BENCH_RUNTIME);
+    scheduler.stop();
+
+    result.elapsed = my_clock::now() - time_start;
+    result.cpu_time = process_cpu_time() - cpu_start;
+    result.lateness = scheduler.stats().dispatch_latency;
+    return result;
+}
+
+
+void
+    report(const char* name, size_t timers, const WakeupResult& result) {
+    double cpu_per_second = static_cast<double>(result.cpu_time.count())
+        / static_cast<double>(result.elapsed.count()) * 1000.0;
+    std::cout << std::setw(7) << std::setfill(' ') << timers << "  "
+        << std::left << std::setw(11) << name << std::right
+        << std::setw(10) << std::chrono::duration_cast<microsec>(
+            result.lateness.average()).count()
+        << std::setw(10) << std::chrono::duration_cast<microsec>(
+            result.lateness.percentile(0.99)).count()
+        << std::setw(10) << std::chrono::duration_cast<microsec>(
+            result.lateness.largest()).count()
+        << std::fixed << std::setprecision(1)
+        << std::setw(12) << cpu_per_second << std::endl;
+}
+
+
+int main() {
+    const size_t counts[] = {10, 100, 1000};
+
+    std::cout << "Each run lasts "
+        << std::chrono::duration_cast<millisec>(BENCH_RUNTIME).count()
+        << " ms. Lateness is in us, CPU is ms of CPU time per second."
+        << std::endl << std::endl;
+    std::cout << " Timers  Waiter       Avg late  p99 late  Max late  CPU (ms/s)"
+        << std::endl;
+
+    for (size_t timers : counts) {
+        report("sleep_until", timers, measure_threads(timers));
+        report("condition", timers,
+               measure_scheduler<ConditionWaiter>(timers));
+#if defined(__linux__)
+        report("epoll", timers, measure_scheduler<EpollWaiter>(timers));
+#endif
+    }
+
+    return 0;
+}
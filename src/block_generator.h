@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "intervals.h"
+#include "random.h"
+
+
+/* Four xoshiro256++ generators run side by side, which fill a block of
+random numbers at a time and hand them out one by one. With AVX2 (built with
+-mavx2 or /arch:AVX2) each step of the four generators is one vector
+instruction per operation; without it the same steps run in a plain loop,
+which the compiler may vectorize itself. Both give the same numbers.
+
+It's a UniformRandomBitGenerator, so jitter is drawn from it with
+uniform_in() like from any other generator, and fill() draws a whole buffer
+of jitters in one range. It only keeps up with a single Xoshiro256pp when the
+lanes run on AVX2, and falls behind without it, so the schedulers draw from it
+only when it's vectorized; see JitterGenerator.
+*/
+class BlockGenerator {
+    static const size_t     LANES = 4;
+    // Numbers made per refill, a multiple of LANES
+    static const size_t     BLOCK = 64;
+
+    // state_[word][lane], so that each word of the four lanes is contiguous
+    uint64_t    state_[4][LANES];
+    uint64_t    block_[BLOCK];
+    size_t      next_ = BLOCK;
+
+#if defined(__AVX2__)
+    static __m256i
+        rotl(__m256i x, int k) {
+        return _mm256_or_si256(_mm256_slli_epi64(x, k),
+                               _mm256_srli_epi64(x, 64 - k));
+    }
+
+    void
+        refill() {
+        __m256i* words = reinterpret_cast<__m256i*>(state_);
+        __m256i s0 = _mm256_loadu_si256(words);
+        __m256i s1 = _mm256_loadu_si256(words + 1);
+        __m256i s2 = _mm256_loadu_si256(words + 2);
+        __m256i s3 = _mm256_loadu_si256(words + 3);
+        for (size_t i = 0; i < BLOCK; i += LANES) {
+            __m256i result = _mm256_add_epi64(
+                rotl(_mm256_add_epi64(s0, s3), 23), s0);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(block_ + i), result);
+            __m256i t = _mm256_slli_epi64(s1, 17);
+            s2 = _mm256_xor_si256(s2, s0);
+            s3 = _mm256_xor_si256(s3, s1);
+            s1 = _mm256_xor_si256(s1, s2);
+            s0 = _mm256_xor_si256(s0, s3);
+            s2 = _mm256_xor_si256(s2, t);
+            s3 = rotl(s3, 45);
+        }
+
+        _mm256_storeu_si256(words, s0);
+        _mm256_storeu_si256(words + 1, s1);
+        _mm256_storeu_si256(words + 2, s2);
+        _mm256_storeu_si256(words + 3, s3);
+        next_ = 0;
+    }
+#else
+    static uint64_t
+        rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+    void
+        refill() {
+        for (size_t i = 0; i < BLOCK; i += LANES) {
+            for (size_t lane = 0; lane < LANES; ++lane) {
+                uint64_t& s0 = state_[0][lane];
+                uint64_t& s1 = state_[1][lane];
+                uint64_t& s2 = state_[2][lane];
+                uint64_t& s3 = state_[3][lane];
+                block_[i + lane] = rotl(s0 + s3, 23) + s0;
+                uint64_t t = s1 << 17;
+                s2 ^= s0;
+                s3 ^= s1;
+                s1 ^= s2;
+                s0 ^= s3;
+                s2 ^= t;
+                s3 = rotl(s3, 45);
+            }
+        }
+
+        next_ = 0;
+    }
+#endif
+
+public:
+    using result_type = uint64_t;
+
+    explicit BlockGenerator(uint64_t seed = random_seed()) {
+        SplitMix64 mix(seed);
+        for (auto& word : state_) {
+            for (uint64_t& lane : word) {
+                lane = mix();
+            }
+        }
+    }
+
+    static constexpr result_type
+        min() {
+        return 0;
+    }
+
+    static constexpr result_type
+        max() {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    //! @brief whether the lanes run on AVX2.
+    static constexpr bool
+        vectorized() {
+#if defined(__AVX2__)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    result_type
+        operator()() {
+        if (next_ == BLOCK) {
+            refill();
+        }
+
+        return block_[next_++];
+    }
+
+    //! @brief fill jitters with count uniform jitters in [min, max], mapped
+    // straight from the block with Lemire's method, like uniform_below().
+    void
+        fill(resolution* jitters, size_t count, resolution min, resolution max) {
+        uint64_t span = static_cast<uint64_t>(max.count() - min.count()) + 1;
+        uint64_t threshold = (0 - span) % span;
+        for (size_t i = 0; i < count; ++i) {
+            if (next_ == BLOCK) {
+                refill();
+            }
+
+            uint64_t low;
+            uint64_t offset = multiply_high(block_[next_++], span, low);
+            while (low < threshold) {
+                offset = multiply_high((*this)(), span, low);
+            }
+
+            jitters[i] = min + resolution(static_cast<resolution::rep>(offset));
+        }
+    }
+};
+
+
+/* The generator the schedulers draw jitter from as they re-arm their timers.
+Where the lanes run on AVX2 it's a BlockGenerator, so a tick that re-arms
+thousands of timers refills a block of 64 numbers at a time and maps each one
+into its timer's own range with uniform_in(). Elsewhere it's Xoshiro256pp,
+which is faster than the lanes in a plain loop.
+*/
+using JitterGenerator = std::conditional<BlockGenerator::vectorized(),
+                                         BlockGenerator, Xoshiro256pp>::type;
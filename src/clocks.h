@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+
+#if defined(__linux__)
+#include <ctime>
+#endif
+
+#include "intervals.h"
+#include "platform.h"
+
+
+/* Clock sources a timer can tell the time with. A Clock has
+
+    static my_clock::time_point now()
+
+and every Clock returns time points on the same timeline as my_clock, so a
+reading from one can be compared with deadlines and with readings from the
+others. To use one with PeriodicTimer, wrap its sleeper in ClockedSleeper.
+*/
+
+
+/* my_clock (steady_clock) itself. This is the default. */
+struct SteadyClock {
+    static my_clock::time_point
+        now() {
+        return my_clock::now();
+    }
+};
+
+
+#if defined(__linux__)
+/* CLOCK_MONOTONIC through clock_gettime directly, which the vDSO answers
+without a system call. It's the clock steady_clock reads, without the
+library in between.
+*/
+struct MonotonicClock {
+    static my_clock::time_point
+        now() {
+        timespec time;
+        clock_gettime(CLOCK_MONOTONIC, &time);
+        return from_monotonic_timespec(time);
+    }
+};
+
+
+/* CLOCK_MONOTONIC_COARSE, which returns the time of the last scheduler tick,
+so it's only as precise as a tick (1 to 4 ms, see clock_getres), but it's
+cheaper to read because it doesn't read the hardware counter. Use it where
+tick-level precision is enough: lateness measured with it is only good to
+a tick, and readings can be up to a tick behind the other clocks.
+*/
+struct CoarseClock {
+    static my_clock::time_point
+        now() {
+        timespec time;
+        clock_gettime(CLOCK_MONOTONIC_COARSE, &time);
+        return from_monotonic_timespec(time);
+    }
+
+    //! @brief how far apart its readings are.
+    static resolution
+        precision() {
+        timespec time;
+        clock_getres(CLOCK_MONOTONIC_COARSE, &time);
+        return resolution(int64_t(time.tv_sec) * 1000000000 + time.tv_nsec);
+    }
+};
+#endif
+
+
+/* A Sleeper (see sleepers.h) that sleeps like Sleeper but tells the time
+with Clock, for example ClockedSleeper<ConditionSleeper, CoarseClock>.
+*/
+template <typename Sleeper, typename Clock>
+class ClockedSleeper : public Sleeper {
+public:
+    my_clock::time_point
+        now() const {
+        return Clock::now();
+    }
+};
@@ -0,0 +1,196 @@
+#pragma once
+
+// Coroutines need C++20: /std:c++latest or /std:c++20 with MSVC, -std=c++20
+// with GCC and Clang. Without them this header defines nothing.
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define INTERVALS_HAVE_COROUTINES 1
+#endif
+#endif
+
+#if defined(INTERVALS_HAVE_COROUTINES)
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <coroutine>
+#include <exception>
+
+#include "intervals.h"
+#include "scheduler.h"
+
+
+/* The return type of a coroutine that runs periodic work, such as
+
+    PeriodicTask poll(CoroutineTimer<>& timer) {
+        for (;;) {
+            resolution jitter = co_await timer.next_tick();
+            ...
+        }
+    }
+
+The coroutine starts running as soon as it's called, and its frame is freed
+when it returns or when the timer it's waiting on is destroyed. Nothing waits
+for it, so there's nothing to keep.
+*/
+class PeriodicTask {
+    static std::atomic<size_t>&
+        frame_bytes_total() {
+        static std::atomic<size_t> total(0);
+        return total;
+    }
+
+public:
+    struct promise_type {
+        PeriodicTask
+            get_return_object() {
+            return PeriodicTask();
+        }
+
+        std::suspend_never
+            initial_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_never
+            final_suspend() noexcept {
+            return {};
+        }
+
+        void
+            return_void() {
+        }
+
+        void
+            unhandled_exception() {
+            std::terminate();
+        }
+
+        // Count the bytes of every frame, so the cost per task can be shown
+        static void*
+            operator new(size_t size) {
+            frame_bytes_total() += size;
+            size_t* block = static_cast<size_t*>(
+                ::operator new(size + sizeof(std::max_align_t)));
+            *block = size;
+            return reinterpret_cast<char*>(block) + sizeof(std::max_align_t);
+        }
+
+        static void
+            operator delete(void* frame) {
+            size_t* block = reinterpret_cast<size_t*>(
+                static_cast<char*>(frame) - sizeof(std::max_align_t));
+            frame_bytes_total() -= *block;
+            ::operator delete(block);
+        }
+    };
+
+    //! @brief the bytes used by the frames of all of the coroutines that are
+    // still alive.
+    static size_t
+        frame_bytes() {
+        return frame_bytes_total().load();
+    }
+};
+
+
+/* A periodic timer for coroutines. Instead of a thread blocked in
+PeriodicTimer::doItTimed, a coroutine suspends in co_await timer.next_tick()
+and is resumed by the scheduler thread at the start of each interval plus a
+random jitter, with the jitter as the result. Thousands of them share one
+scheduler thread, and each costs only its coroutine frame and the scheduler's
+entry for the timer.
+
+The timer keeps ticking whether or not a coroutine is waiting. A tick that
+finds no coroutine waiting, because the previous one is still running, is
+counted by missed_ticks().
+
+If the scheduler has an executor, the coroutine is resumed on the executor's
+worker instead. Destroy the timer after the scheduler is stopped, or from the
+coroutine's own thread; a coroutine still waiting on it is destroyed with it.
+*/
+template <typename SchedulerType = WheelScheduler>
+class CoroutineTimer {
+    SchedulerType&                  scheduler_;
+    typename SchedulerType::TimerId id_;
+    // The coroutine waiting for the next tick, or nullptr
+    std::atomic<void*>              waiting_;
+    resolution                      jitter_;
+    std::atomic<uint64_t>           missed_ticks_;
+
+    void
+        tick(resolution jitter) {
+        void* address = waiting_.exchange(nullptr);
+        if (address == nullptr) {
+            ++missed_ticks_;
+            return;
+        }
+
+        jitter_ = jitter;
+        std::coroutine_handle<>::from_address(address).resume();
+    }
+
+public:
+    class Awaiter {
+        CoroutineTimer& timer_;
+
+    public:
+        explicit Awaiter(CoroutineTimer& timer)
+            : timer_(timer) {
+        }
+
+        bool
+            await_ready() const noexcept {
+            return false;
+        }
+
+        void
+            await_suspend(std::coroutine_handle<> waiting) noexcept {
+            timer_.waiting_.store(waiting.address());
+        }
+
+        resolution
+            await_resume() const noexcept {
+            return timer_.jitter_;
+        }
+    };
+
+    //! @brief add a timer to the scheduler that ticks every interval, delayed
+    // by a random jitter in [jitter_min, jitter_max].
+    CoroutineTimer(SchedulerType& scheduler,
+                   resolution interval,
+                   resolution jitter_min,
+                   resolution jitter_max)
+        : scheduler_(scheduler)
+        , waiting_(nullptr)
+        , jitter_(0)
+        , missed_ticks_(0) {
+        id_ = scheduler_.add(interval, jitter_min, jitter_max,
+                             [this](resolution jitter) { tick(jitter); });
+    }
+
+    ~CoroutineTimer() {
+        scheduler_.cancel(id_);
+        void* address = waiting_.exchange(nullptr);
+        if (address != nullptr) {
+            std::coroutine_handle<>::from_address(address).destroy();
+        }
+    }
+
+    CoroutineTimer(const CoroutineTimer&) = delete;
+    CoroutineTimer& operator=(const CoroutineTimer&) = delete;
+
+    //! @brief co_await it to suspend until the next tick. The result is that
+    // tick's jitter. Only one coroutine may wait on a timer at a time.
+    Awaiter
+        next_tick() {
+        return Awaiter(*this);
+    }
+
+    uint64_t
+        missed_ticks() const {
+        return missed_ticks_.load();
+    }
+};
+
+#endif
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <chrono>
+
+#include "intervals.h"
+
+
+/* A running estimate of how long a callback takes: an exponentially weighted
+moving average (EWMA) of its durations, and a streaming estimate of their
+95th percentile. An insert is a few integer operations, and nothing is kept
+but the two estimates, so every timer can have one.
+
+The percentile estimate moves up 19 steps when a duration is above it and
+down one step when it isn't, so it settles where 1 duration in 20 is above
+it. A step is 1/64 of the average, so it adapts at the same pace whatever
+the callback's scale, and follows a callback that slows down or speeds up.
+*/
+class CostEstimate {
+    // Each new duration has a weight of 1/2^WEIGHT_SHIFT in the average
+    static const int                WEIGHT_SHIFT = 3;
+    // A step of the percentile is 1/2^STEP_SHIFT of the average
+    static const int                STEP_SHIFT = 6;
+    // Steps up for every step down: 19 for the 95th percentile
+    static const resolution::rep    UP_STEPS = 19;
+
+    resolution::rep     average_ = 0;
+    resolution::rep     high_ = 0;
+    uint64_t            count_ = 0;
+
+public:
+    void
+        insert(duration value) {
+        resolution::rep ns = std::max(
+            std::chrono::duration_cast<resolution>(value).count(),
+            resolution::rep(0));
+        if (count_++ == 0) {
+            average_ = ns;
+            high_ = ns;
+            return;
+        }
+
+        average_ += (ns - average_) / (resolution::rep(1) << WEIGHT_SHIFT);
+        resolution::rep step = std::max(average_ >> STEP_SHIFT,
+                                        resolution::rep(1));
+        if (ns > high_) {
+            high_ += step * UP_STEPS;
+        } else {
+            high_ = std::max(high_ - step, resolution::rep(0));
+        }
+    }
+
+    uint64_t
+        count() const {
+        return count_;
+    }
+
+    //! @brief the EWMA of the durations.
+    resolution
+        average() const {
+        return resolution(average_);
+    }
+
+    //! @brief the estimate of the 95th percentile of the durations.
+    resolution
+        high() const {
+        return resolution(high_);
+    }
+
+    //! @brief how long the next call is expected to take, at worst: the
+    // higher of the two estimates, or 0 before the first duration.
+    resolution
+        predicted() const {
+        return resolution(std::max(average_, high_));
+    }
+};
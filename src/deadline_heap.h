@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "intervals.h"
+#include "timer_node.h"
+
+
+/* A 4-ary min-heap of timers ordered by deadline. Compared to the timing
+wheel it fires timers at their exact deadline instead of on a tick, at the
+cost of O(log n) insert, cancel and expire, which is a good trade when there
+are few timers.
+
+The heap is an array of (deadline, node) pairs, so sifting compares deadlines
+without following a pointer to each node. With four children per node the
+heap is half as deep as a binary heap, and the children of a node are next to
+each other in memory.
+*/
+class DeadlineHeap {
+    static const size_t ARITY = 4;
+
+    struct Item {
+        my_clock::time_point    deadline;
+        TimerNode*              node;
+    };
+
+    std::vector<Item>   items_;
+
+    void
+        put(size_t index, const Item& item) {
+        items_[index] = item;
+        item.node->heap_index = index;
+    }
+
+    void
+        sift_up(size_t index) {
+        Item item = items_[index];
+        while (index > 0) {
+            size_t parent = (index - 1) / ARITY;
+            if (!(item.deadline < items_[parent].deadline)) {
+                break;
+            }
+
+            put(index, items_[parent]);
+            index = parent;
+        }
+
+        put(index, item);
+    }
+
+    void
+        sift_down(size_t index) {
+        Item item = items_[index];
+        size_t size = items_.size();
+        for (;;) {
+            size_t first = index * ARITY + 1;
+            if (first >= size) {
+                break;
+            }
+
+            size_t last = first + ARITY < size ? first + ARITY : size;
+            size_t smallest = first;
+            for (size_t child = first + 1; child < last; ++child) {
+                if (items_[child].deadline < items_[smallest].deadline) {
+                    smallest = child;
+                }
+            }
+
+            if (!(items_[smallest].deadline < item.deadline)) {
+                break;
+            }
+
+            put(index, items_[smallest]);
+            index = smallest;
+        }
+
+        put(index, item);
+    }
+
+    //! @brief remove the item at index and return its node.
+    TimerNode*
+        remove_at(size_t index) {
+        TimerNode* node = items_[index].node;
+        node->heap_index = TimerNode::NOT_IN_HEAP;
+
+        Item last = items_.back();
+        items_.pop_back();
+        if (index < items_.size()) {
+            // Fill the hole with the last item, which may have to move either
+            // way from there.
+            put(index, last);
+            if (index > 0 && last.deadline < items_[(index - 1) / ARITY].deadline) {
+                sift_up(index);
+            } else {
+                sift_down(index);
+            }
+        }
+
+        return node;
+    }
+
+public:
+    // The heap has no origin or tick, but takes the same arguments as
+    // TimingWheel so a Scheduler can construct either one.
+    explicit DeadlineHeap(my_clock::time_point = my_clock::now(),
+                          duration = duration(0)) {
+    }
+
+    void
+        insert(TimerNode* node) {
+        Item item = {node->deadline, node};
+        items_.push_back(item);
+        sift_up(items_.size() - 1);
+    }
+
+    //! @brief remove a timer that hasn't expired. Returns false if the timer
+    // wasn't in the heap.
+    bool
+        cancel(TimerNode* node) {
+        if (node->heap_index == TimerNode::NOT_IN_HEAP) {
+            return false;
+        }
+
+        remove_at(node->heap_index);
+        return true;
+    }
+
+    //! @brief expire every timer whose deadline is at or before now, calling
+    // expire(TimerNode*) for each after it has been removed from the heap.
+    template <typename Expire>
+    void
+        advance(my_clock::time_point now, Expire expire) {
+        while (!items_.empty() && items_.front().deadline <= now) {
+            expire(remove_at(0));
+        }
+    }
+
+    //! @brief the earliest deadline, or time_point::max() if the heap is
+    // empty.
+    my_clock::time_point
+        next_expiry() const {
+        if (items_.empty()) {
+            return my_clock::time_point::max();
+        }
+
+        return items_.front().deadline;
+    }
+
+    duration
+        granularity() const {
+        return duration(0);
+    }
+
+    size_t
+        size() const {
+        return items_.size();
+    }
+
+    bool
+        empty() const {
+        return items_.empty();
+    }
+};
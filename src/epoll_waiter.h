@@ -0,0 +1,175 @@
+#pragma once
+
+#if defined(__linux__)
+
+#include <cstdint>
+#include <cerrno>
+#include <ctime>
+#include <functional>
+#include <mutex>
+#include <system_error>
+#include <unordered_map>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "intervals.h"
+#include "platform.h"
+
+
+/* A Waiter for Scheduler that sleeps in epoll_wait. One timerfd, armed with
+an absolute CLOCK_MONOTONIC time, serves every timer in the scheduler, and an
+eventfd wakes the thread when a command is queued or the scheduler stops.
+
+Other file descriptors, such as sockets, can be added with watch(). Their
+handlers run on the scheduler thread, so the timers and the sockets share one
+event loop.
+*/
+class EpollWaiter {
+    int                 epoll_fd_;
+    int                 timer_fd_;
+    int                 event_fd_;
+    // The deadline timer_fd_ is armed for, so it's only re-armed on change
+    my_clock::time_point armed_ = my_clock::time_point::max();
+    std::mutex          handlers_mutex_;
+    std::unordered_map<int, std::function<void(uint32_t)>> handlers_;
+
+    static const int    MAX_EVENTS = 32;
+
+    static int
+        check(int result, const char* what) {
+        if (result < 0) {
+            throw std::system_error(errno, std::generic_category(), what);
+        }
+
+        return result;
+    }
+
+    void
+        add_fd(int fd, uint32_t events) {
+        epoll_event event = {};
+        event.events = events;
+        event.data.fd = fd;
+        check(epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event), "epoll_ctl");
+    }
+
+    static void
+        drain(int fd) {
+        uint64_t count;
+        while (read(fd, &count, sizeof(count)) == sizeof(count)) {
+        }
+    }
+
+    void
+        arm(my_clock::time_point deadline) {
+        if (deadline == armed_) {
+            return;
+        }
+
+        // A zero it_value disarms the timer
+        itimerspec spec = {};
+        if (deadline != my_clock::time_point::max()) {
+            spec.it_value = to_monotonic_timespec(deadline);
+            if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0) {
+                spec.it_value.tv_nsec = 1;
+            }
+        }
+
+        check(timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, nullptr),
+              "timerfd_settime");
+        armed_ = deadline;
+    }
+
+public:
+    EpollWaiter()
+        : epoll_fd_(check(epoll_create1(EPOLL_CLOEXEC), "epoll_create1"))
+        , timer_fd_(check(timerfd_create(CLOCK_MONOTONIC,
+                                         TFD_NONBLOCK | TFD_CLOEXEC),
+                          "timerfd_create"))
+        , event_fd_(check(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC), "eventfd")) {
+        add_fd(timer_fd_, EPOLLIN);
+        add_fd(event_fd_, EPOLLIN);
+    }
+
+    ~EpollWaiter() {
+        close(event_fd_);
+        close(timer_fd_);
+        close(epoll_fd_);
+    }
+
+    EpollWaiter(const EpollWaiter&) = delete;
+    EpollWaiter& operator=(const EpollWaiter&) = delete;
+
+    void
+        wait_until(my_clock::time_point deadline) {
+        arm(deadline);
+
+        epoll_event events[MAX_EVENTS];
+        int count = epoll_wait(epoll_fd_, events, MAX_EVENTS, -1);
+        for (int i = 0; i < count; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == timer_fd_) {
+                // It's a one-shot timer, so it has to be armed again
+                drain(timer_fd_);
+                armed_ = my_clock::time_point::max();
+            } else if (fd == event_fd_) {
+                drain(event_fd_);
+            } else {
+                std::function<void(uint32_t)> handler;
+                {
+                    std::lock_guard<std::mutex> guard(handlers_mutex_);
+                    auto found = handlers_.find(fd);
+                    if (found != handlers_.end()) {
+                        handler = found->second;
+                    }
+                }
+
+                if (handler) {
+                    handler(events[i].events);
+                }
+            }
+        }
+    }
+
+    void
+        notify() {
+        uint64_t one = 1;
+        ssize_t written = write(event_fd_, &one, sizeof(one));
+        (void)written;
+    }
+
+    //! @brief call handler(events) on the scheduler thread whenever fd has
+    // one of the epoll events. Returns false if fd can't be watched.
+    bool
+        watch(int fd, uint32_t events, std::function<void(uint32_t)> handler) {
+        {
+            std::lock_guard<std::mutex> guard(handlers_mutex_);
+            handlers_[fd] = std::move(handler);
+        }
+
+        epoll_event event = {};
+        event.events = events;
+        event.data.fd = fd;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) < 0) {
+            std::lock_guard<std::mutex> guard(handlers_mutex_);
+            handlers_.erase(fd);
+            return false;
+        }
+
+        return true;
+    }
+
+    bool
+        unwatch(int fd) {
+        {
+            std::lock_guard<std::mutex> guard(handlers_mutex_);
+            handlers_.erase(fd);
+        }
+
+        return epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr) == 0;
+    }
+};
+
+#endif
@@ -0,0 +1,268 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <utility>
+
+#include "intervals.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+//! @brief the index of the highest set bit. value must not be 0.
+inline int
+    highest_bit_index(uint64_t value) {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return static_cast<int>(index);
+#elif defined(_MSC_VER)
+    // 32-bit builds only scan 32 bits at a time
+    unsigned long index;
+    if (_BitScanReverse(&index, static_cast<unsigned long>(value >> 32))) {
+        return static_cast<int>(index) + 32;
+    }
+
+    _BitScanReverse(&index, static_cast<unsigned long>(value));
+    return static_cast<int>(index);
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+
+/* Count durations, such as how late a timer woke up, cheaply enough to do it
+on every iteration of a timer: inserting is a bit scan and an increment.
+
+Durations under 16 ns are counted exactly. Above that, every power of two is
+split into 16 buckets of equal width, so a bucket is never wider than 1/16 of
+its value, and percentiles are accurate to within about 6%. The smallest,
+largest and average durations are exact.
+
+The 608 buckets take 4864 bytes, which are only allocated on the first
+insert. An empty histogram is about 50 bytes, so a timer that isn't running,
+or doesn't record, doesn't pay for its histograms.
+*/
+class LatencyHistogram {
+    static const int        SUB_BITS = 4;
+    static const uint64_t   SUB_BUCKETS = uint64_t(1) << SUB_BITS;
+    // Powers of two up to 2^MAX_POWER ns (about 37 minutes) get buckets
+    static const int        MAX_POWER = 40;
+    static const size_t     BUCKETS = (MAX_POWER - SUB_BITS + 2) * SUB_BUCKETS;
+    // Rows of print(): 0 ns, then one per power of two
+    static const size_t     ROWS = MAX_POWER + 2;
+
+    // Allocated on the first insert, or on a merge of a histogram that has
+    // them
+    std::unique_ptr<uint64_t[]> buckets_;
+    uint64_t    count_ = 0;
+    uint64_t    total_ = 0;
+    uint64_t    smallest_ = std::numeric_limits<uint64_t>::max();
+    uint64_t    largest_ = 0;
+
+    static size_t
+        index_of(uint64_t ns) {
+        if (ns < SUB_BUCKETS) {
+            return static_cast<size_t>(ns);
+        }
+
+        // std::min takes references, which would need MAX_POWER defined out
+        // of the class, so pass it a copy
+        const int max_power = MAX_POWER;
+        int power = std::min(highest_bit_index(ns), max_power);
+        uint64_t sub = std::min(ns >> (power - SUB_BITS), 2 * SUB_BUCKETS - 1);
+        return static_cast<size_t>(uint64_t(power - SUB_BITS) * SUB_BUCKETS + sub);
+    }
+
+    //! @brief the smallest duration, in ns, that goes in bucket index.
+    static uint64_t
+        floor_of(size_t index) {
+        if (index < SUB_BUCKETS) {
+            return index;
+        }
+
+        int power = static_cast<int>(index / SUB_BUCKETS) + SUB_BITS - 1;
+        uint64_t sub = index % SUB_BUCKETS + SUB_BUCKETS;
+        return sub << (power - SUB_BITS);
+    }
+
+    //! @brief the row of print() a bucket is shown in.
+    static size_t
+        row_of(size_t index) {
+        uint64_t floor = floor_of(index);
+        return floor == 0 ? 0 : static_cast<size_t>(highest_bit_index(floor)) + 1;
+    }
+
+    static std::string
+        format(uint64_t ns) {
+        const char* units[] = {"ns", "us", "ms", "s"};
+        size_t unit = 0;
+        while (ns >= 1000 && unit < 3) {
+            ns /= 1000;
+            ++unit;
+        }
+
+        return std::to_string(ns) + " " + units[unit];
+    }
+
+    void
+        allocate() {
+        if (!buckets_) {
+            buckets_.reset(new uint64_t[BUCKETS]());
+        }
+    }
+
+public:
+    LatencyHistogram() = default;
+
+    LatencyHistogram(const LatencyHistogram& other)
+        : count_(other.count_)
+        , total_(other.total_)
+        , smallest_(other.smallest_)
+        , largest_(other.largest_) {
+        if (other.buckets_) {
+            allocate();
+            std::copy(other.buckets_.get(), other.buckets_.get() + BUCKETS,
+                      buckets_.get());
+        }
+    }
+
+    LatencyHistogram(LatencyHistogram&&) = default;
+
+    LatencyHistogram&
+        operator=(const LatencyHistogram& other) {
+        LatencyHistogram copy(other);
+        return *this = std::move(copy);
+    }
+
+    LatencyHistogram& operator=(LatencyHistogram&&) = default;
+
+    void
+        insert(duration value) {
+        duration::rep count = std::chrono::duration_cast<nanosec>(value).count();
+        uint64_t ns = count > 0 ? static_cast<uint64_t>(count) : 0;
+        allocate();
+        ++buckets_[index_of(ns)];
+        ++count_;
+        total_ += ns;
+        smallest_ = std::min(smallest_, ns);
+        largest_ = std::max(largest_, ns);
+    }
+
+    void
+        merge(const LatencyHistogram& other) {
+        if (other.buckets_) {
+            allocate();
+            for (size_t i = 0; i < BUCKETS; ++i) {
+                buckets_[i] += other.buckets_[i];
+            }
+        }
+
+        count_ += other.count_;
+        total_ += other.total_;
+        smallest_ = std::min(smallest_, other.smallest_);
+        largest_ = std::max(largest_, other.largest_);
+    }
+
+    uint64_t
+        count() const {
+        return count_;
+    }
+
+    //! @brief the bytes allocated for the buckets, 0 until the first insert.
+    size_t
+        allocated_bytes() const {
+        return buckets_ ? BUCKETS * sizeof(uint64_t) : 0;
+    }
+
+    duration
+        smallest() const {
+        return count_ == 0 ? duration(0)
+            : nanosec(static_cast<nanosec::rep>(smallest_));
+    }
+
+    duration
+        largest() const {
+        return nanosec(static_cast<nanosec::rep>(largest_));
+    }
+
+    duration
+        average() const {
+        return count_ == 0 ? duration(0)
+            : nanosec(static_cast<nanosec::rep>(total_ / count_));
+    }
+
+    //! @brief the duration that fraction (0 to 1) of the durations are no
+    // longer than, to within one bucket. percentile(0.999) is the p99.9.
+    duration
+        percentile(double fraction) const {
+        if (count_ == 0) {
+            return duration(0);
+        }
+
+        uint64_t rank = static_cast<uint64_t>(fraction * static_cast<double>(count_));
+        rank = std::min(std::max(rank, uint64_t(1)), count_);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            seen += buckets_[i];
+            if (seen >= rank) {
+                // The top of the bucket, but never past the largest duration
+                uint64_t top = i + 1 < BUCKETS ? floor_of(i + 1) - 1 : largest_;
+                top = std::max(std::min(top, largest_), smallest_);
+                return nanosec(static_cast<nanosec::rep>(top));
+            }
+        }
+
+        return largest();
+    }
+
+    //! @brief print one line per power of two, from the first to the last
+    // that isn't empty, with its range, count, percentage and a bar.
+    void
+        print(std::ostream& out, size_t bar_width = 40) const {
+        if (count_ == 0) {
+            return;
+        }
+
+        uint64_t rows[ROWS] = {};
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            rows[row_of(i)] += buckets_[i];
+        }
+
+        size_t first = 0;
+        while (first < ROWS && rows[first] == 0) {
+            ++first;
+        }
+
+        size_t last = ROWS;
+        while (last > first && rows[last - 1] == 0) {
+            --last;
+        }
+
+        uint64_t most = 0;
+        for (size_t i = first; i < last; ++i) {
+            most = std::max(most, rows[i]);
+        }
+
+        for (size_t i = first; i < last; ++i) {
+            uint64_t floor = i == 0 ? 0 : uint64_t(1) << (i - 1);
+            double percent = 100.0 * static_cast<double>(rows[i])
+                / static_cast<double>(count_);
+            size_t bar = static_cast<size_t>(rows[i] * bar_width / most);
+            out << "  >= " << std::left << std::setw(7) << std::setfill(' ')
+                << format(floor) << std::right
+                << std::setw(9) << rows[i]
+                << std::fixed << std::setprecision(1) << std::setw(7)
+                << percent << "%  " << std::string(bar, '#') << std::endl;
+        }
+    }
+};
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+
+using microsec = std::chrono::microseconds;
+using millisec = std::chrono::milliseconds;
+using nanosec = std::chrono::nanoseconds;
+using resolution = nanosec;
+using my_clock = std::chrono::steady_clock;
+using duration = my_clock::duration;
+
+// 10 ms == 10,000,000 ns
+#define INTERVAL_PERIOD         resolution(10000000)
+
+// 0.1 ms == 100,000 ns
+#define JITTER_MIN              100000
+
+// 1 ms == 1,000,000 ns
+#define JITTER_MAX              1000000
+
+// Maximum number of iterations to run doItCounted
+#define ITERATION_MAX           400
+
+// 4 s = 4,000,000,000 ns
+#define RUNTIME_LIMIT    resolution(4000000000)
+
+// Number of timers run by one Scheduler in the scheduler test
+#define SCHEDULER_TIMERS        1000
+
+// Define a consistant display width for various values
+#define DWIDTH  5
+
+/* Every duration inserted, for the smallest, largest, average and median.
+Only inserted durations count; room for ITERATION_MAX of them is reserved up
+front. */
+class TimeDurations {
+    std::vector<duration> event_duration_;
+    duration smallest_;
+    duration largest_;
+
+public:
+    TimeDurations()
+        : smallest_(resolution::max())
+        , largest_(resolution::min()) {
+        event_duration_.reserve(ITERATION_MAX);
+    }
+
+    void
+        insert(duration ed) {
+        event_duration_.push_back(ed);
+
+        if (ed < smallest_) {
+            smallest_ = ed;
+        }
+
+        if (ed > largest_) {
+            largest_ = ed;
+        }
+    }
+
+    duration average() {
+        duration result(0);
+        if (event_duration_.empty()) {
+            return result;
+        }
+
+        for (auto ed : event_duration_) {
+            result = result + ed;
+        }
+
+        result /= event_duration_.size();
+
+        return result;
+    }
+
+    duration
+        largest() {
+        return largest_;
+    }
+
+    duration
+        smallest() {
+        return smallest_;
+    }
+
+    duration
+        median() {
+        if (event_duration_.empty()) {
+            return duration(0);
+        }
+
+        std::sort(event_duration_.begin(), event_duration_.end());
+        return event_duration_[event_duration_.size() / 2];
+    }
+};
+
+
+/* A running summary of durations: count, sum, smallest and largest. Unlike
+TimeDurations it doesn't keep every sample, so it can be left running for as
+long as a scheduler runs, and summaries from several sources can be merged.
+*/
+class DurationStats {
+    uint64_t count_;
+    duration total_;
+    duration smallest_;
+    duration largest_;
+
+public:
+    DurationStats()
+        : count_(0)
+        , total_(0)
+        , smallest_(resolution::max())
+        , largest_(resolution::min()) {
+    }
+
+    void
+        insert(duration ed) {
+        ++count_;
+        total_ += ed;
+
+        if (ed < smallest_) {
+            smallest_ = ed;
+        }
+
+        if (ed > largest_) {
+            largest_ = ed;
+        }
+    }
+
+    void
+        merge(const DurationStats& other) {
+        count_ += other.count_;
+        total_ += other.total_;
+
+        if (other.smallest_ < smallest_) {
+            smallest_ = other.smallest_;
+        }
+
+        if (other.largest_ > largest_) {
+            largest_ = other.largest_;
+        }
+    }
+
+    uint64_t
+        count() const {
+        return count_;
+    }
+
+    duration
+        average() const {
+        if (count_ == 0) {
+            return duration(0);
+        }
+
+        return total_ / static_cast<duration::rep>(count_);
+    }
+
+    duration
+        largest() const {
+        return count_ == 0 ? duration(0) : largest_;
+    }
+
+    duration
+        smallest() const {
+        return count_ == 0 ? duration(0) : smallest_;
+    }
+};
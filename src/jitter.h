@@ -0,0 +1,406 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <random>
+#include <string>
+
+#include "intervals.h"
+#include "random.h"
+
+
+/* Where PeriodicTimer gets the jitter for each iteration. A Jitter has
+
+    template <typename Generator>
+    resolution next(Generator& gen, resolution interval)
+        the jitter for the next iteration, drawn with gen, where interval is
+        the interval it falls in. Only the timer thread calls it.
+
+Uniform jitter is drawn with uniform_in() (see random.h), which is cheaper
+than std::uniform_int_distribution.
+
+StaticJitter fixes the range at compile time, which is what
+PeriodicTimer<IntervalMin, IntervalMax> uses. RuntimeJitter can be set per
+timer, and changed from any thread while the timer runs.
+
+The other policies spread a fleet's calls in other ways, the way clients
+retrying against a server usually do: FullJitter, EqualJitter,
+DecorrelatedJitter and ExponentialJitter. PhaseJitter gives each client the
+same place in every interval, picked from its ID. GoldenRatioJitter and
+SharedGoldenRatioJitter fill the range evenly instead of at random. Each is
+its own type, so a timer only pays for the one it uses.
+*/
+
+
+/* A uniform jitter in [Min, Max] ns, fixed at compile time, so it takes no
+memory and the range is a constant in every draw. */
+template <int Min, int Max>
+class StaticJitter {
+public:
+    template <typename Generator>
+    resolution
+        next(Generator& gen, resolution) {
+        return resolution(uniform_in(gen, Min, Max));
+    }
+};
+
+
+/* The shape of a RuntimeJitter's distribution over its range. */
+enum class JitterShape {
+    // Every jitter in the range is equally likely
+    UNIFORM,
+    // Clustered around the middle of the range, with a standard deviation
+    // of 1/6 of the range, and clamped to it
+    NORMAL
+};
+
+
+/* A jitter range and shape set per timer, which set() can change from any
+thread while the timer runs. The timer thread sees a change on its next
+draw. Until then, a draw costs one atomic load more than StaticJitter.
+*/
+class RuntimeJitter {
+    // Serializes set(), and versions its changes for the timer thread
+    std::mutex              mutex_;
+    std::atomic<uint64_t>   version_{0};
+    std::atomic<resolution::rep> min_;
+    std::atomic<resolution::rep> max_;
+    std::atomic<JitterShape> shape_;
+
+    // The timer thread's copy of the settings, as of seen_
+    uint64_t                seen_ = 0;
+    JitterShape             shape_seen_;
+    std::normal_distribution<double> normal_;
+    resolution::rep         min_seen_;
+    resolution::rep         max_seen_;
+
+    void
+        load() {
+        // Read the settings until no set() ran meanwhile
+        uint64_t version;
+        do {
+            version = version_.load(std::memory_order_acquire);
+            min_seen_ = min_.load(std::memory_order_relaxed);
+            max_seen_ = max_.load(std::memory_order_relaxed);
+            shape_seen_ = shape_.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while (version != version_.load(std::memory_order_acquire)
+                 || version % 2 != 0);
+
+        seen_ = version;
+        double middle = (static_cast<double>(min_seen_)
+                         + static_cast<double>(max_seen_)) / 2;
+        double spread = static_cast<double>(max_seen_ - min_seen_) / 6;
+        normal_ = std::normal_distribution<double>(middle,
+                                                   std::max(spread, 1.0));
+    }
+
+public:
+    explicit RuntimeJitter(resolution min = resolution(JITTER_MIN),
+                           resolution max = resolution(JITTER_MAX),
+                           JitterShape shape = JitterShape::UNIFORM)
+        : min_(min.count())
+        , max_(max.count())
+        , shape_(shape) {
+        load();
+    }
+
+    //! @brief use a new range and shape from the timer's next draw on. Safe
+    // to call from any thread.
+    void
+        set(resolution min, resolution max,
+            JitterShape shape = JitterShape::UNIFORM) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // An odd version means a change is half written
+        version_.fetch_add(1, std::memory_order_acq_rel);
+        min_.store(min.count(), std::memory_order_relaxed);
+        max_.store(max.count(), std::memory_order_relaxed);
+        shape_.store(shape, std::memory_order_relaxed);
+        version_.fetch_add(1, std::memory_order_release);
+    }
+
+    resolution
+        min() const {
+        return resolution(min_.load());
+    }
+
+    resolution
+        max() const {
+        return resolution(max_.load());
+    }
+
+    JitterShape
+        shape() const {
+        return shape_.load();
+    }
+
+    template <typename Generator>
+    resolution
+        next(Generator& gen, resolution) {
+        if (version_.load(std::memory_order_acquire) != seen_) {
+            load();
+        }
+
+        if (shape_seen_ == JitterShape::UNIFORM) {
+            return resolution(uniform_in(gen, min_seen_, max_seen_));
+        }
+
+        double value = std::min(std::max(normal_(gen),
+                                         static_cast<double>(min_seen_)),
+                                static_cast<double>(max_seen_));
+        return resolution(static_cast<resolution::rep>(value));
+    }
+};
+
+
+/* Full jitter: anywhere in the interval, [0, interval). It spreads a fleet's
+calls the most evenly, but one client's calls can come almost back-to-back,
+at the end of one interval and the start of the next. */
+class FullJitter {
+public:
+    template <typename Generator>
+    resolution
+        next(Generator& gen, resolution interval) {
+        if (interval.count() <= 0) {
+            // The range would be empty
+            return resolution(0);
+        }
+
+        return resolution(uniform_in(gen, 0, interval.count() - 1));
+    }
+};
+
+
+/* Equal jitter: anywhere in the second half of the interval,
+[interval / 2, interval). A client's calls are then at least half an interval
+apart, at the cost of a fleet's calls crowding into half of each interval. */
+class EqualJitter {
+public:
+    template <typename Generator>
+    resolution
+        next(Generator& gen, resolution interval) {
+        if (interval.count() <= 0) {
+            // The range would be empty
+            return resolution(0);
+        }
+
+        resolution::rep half = interval.count() / 2;
+        return resolution(uniform_in(gen, half, interval.count() - 1));
+    }
+};
+
+
+/* Decorrelated jitter, as AWS describes it for retries: each jitter is drawn
+from [Base, 3 times the last one], and capped at Cap ns. The jitters wander
+around the range instead of being drawn afresh, so clients that started in
+step drift apart. The first one is drawn from [Base, 3 * Base]. Keep Cap
+below the interval. */
+template <int Base, int Cap>
+class DecorrelatedJitter {
+    // With a Base of 0 every jitter would be 0
+    static_assert(Base > 0 && Base <= Cap, "need 0 < Base <= Cap");
+
+    resolution::rep         last_ = Base;
+
+public:
+    template <typename Generator>
+    resolution
+        next(Generator& gen, resolution) {
+        last_ = std::min<resolution::rep>(Cap, uniform_in(gen, Base, last_ * 3));
+        return resolution(last_);
+    }
+};
+
+
+/* Exponential jitter: the time from the start of the interval to the first
+call of a Poisson process with a mean gap of Mean ns, drawn again when it
+falls past the interval. A timer calls once per interval, so its own calls
+can't be a Poisson process, but this is the time each interval waits for one.
+The calls of a fleet bunch up early in each interval, more so the smaller
+Mean is next to the interval. An interval of 0 gets a jitter of 0. */
+template <int Mean>
+class ExponentialJitter {
+public:
+    template <typename Generator>
+    resolution
+        next(Generator& gen, resolution interval) {
+        if (interval.count() <= 0) {
+            // No draw could fall inside it
+            return resolution(0);
+        }
+
+        double limit = static_cast<double>(interval.count());
+        double value;
+        do {
+            value = -std::log1p(-uniform_unit(gen)) * Mean;
+        } while (value >= limit);
+
+        return resolution(static_cast<resolution::rep>(value));
+    }
+};
+
+
+//! @brief a 64-bit hash (FNV-1a) of a client ID such as a host name, for
+// PhaseJitter::set().
+inline uint64_t
+    hash_client_id(const std::string& client_id) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (char c : client_id) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+
+/* A fixed phase per client: the same jitter in every interval, picked from a
+hash of the client's ID, so a fleet spreads over the interval and stays
+spread, and no random number is drawn while the timer runs. A phase is only
+worked out again when the interval changes.
+
+Hashed phases still land in clumps, like random ones do. When each client
+knows its index among the N clients, set_slot() spaces them exactly
+interval / N apart instead, for a flat arrival rate.
+
+Call set() or set_slot() before the timer starts. Until then it's client 0.
+*/
+class PhaseJitter {
+    uint64_t                hash_ = 0;
+    // 0 for a hashed phase, and otherwise the client's slot of slots_
+    uint64_t                slot_ = 0;
+    uint64_t                slots_ = 0;
+    // The interval phase_ was worked out for
+    resolution              interval_{0};
+    resolution              phase_{0};
+
+public:
+    PhaseJitter() {
+        set(0);
+    }
+
+    //! @brief place the client at the phase picked by client_id, the same
+    // way on every host.
+    void
+        set(uint64_t client_id) {
+        hash_ = SplitMix64(client_id)();
+        slots_ = 0;
+        interval_ = resolution(0);
+    }
+
+    //! @brief place the client in slot slot of slots evenly spaced ones,
+    // where clients 0 to slots - 1 each take their own. With no slots, the
+    // phase is hashed from slot instead, as set(slot) does.
+    void
+        set_slot(uint64_t slot, uint64_t slots) {
+        if (slots == 0) {
+            set(slot);
+            return;
+        }
+
+        slot_ = slot % slots;
+        slots_ = slots;
+        interval_ = resolution(0);
+    }
+
+    template <typename Generator>
+    resolution
+        next(Generator&, resolution interval) {
+        if (interval != interval_) {
+            uint64_t length = static_cast<uint64_t>(interval.count());
+            uint64_t low;
+            // slot_ * length alone can overflow 64 bits
+            uint64_t phase = slots_ == 0
+                ? multiply_high(hash_, length, low)
+                : multiply_divide(slot_, length, slots_);
+            phase_ = resolution(static_cast<resolution::rep>(phase));
+            interval_ = interval;
+        }
+
+        return phase_;
+    }
+};
+
+
+// 2^64 / the golden ratio, the step of the golden ratio sequence
+#define GOLDEN_RATIO_STEP       0x9e3779b97f4a7c15ULL
+
+
+//! @brief the position of the golden ratio sequence the
+// SharedGoldenRatioJitters of the process share.
+inline std::atomic<uint64_t>&
+    shared_golden_ratio_position() {
+    static std::atomic<uint64_t> position{random_seed()};
+    return position;
+}
+
+
+//! @brief the golden ratio sequence the GoldenRatioJitters of the process
+// take their starts from.
+inline std::atomic<uint64_t>&
+    golden_ratio_start() {
+    static std::atomic<uint64_t> start{random_seed()};
+    return start;
+}
+
+
+/* A low-discrepancy jitter in [Min, Max] ns: the fractional parts of
+start + n / the golden ratio, for n = 1, 2, 3... Each jitter lands in one of
+the biggest gaps the ones before it left, so the timer's jitters cover the
+range evenly within a few iterations, and two in a row are never closer than
+0.38 of the range, where random ones clump. It costs one addition and one
+multiplication a draw.
+
+Every timer takes the same step, so timers keep the distance between their
+starts. A timer made without a seed takes the next start of a golden ratio
+sequence the process shares, so the timers of one process are spread evenly
+in every iteration, as with SharedGoldenRatioJitter, without sharing anything
+while they run. A seed picks the start instead, for a run that can be
+repeated, but timers with different seeds can start, and stay, close
+together.
+*/
+template <int Min, int Max>
+class GoldenRatioJitter {
+    uint64_t                position_;
+
+public:
+    GoldenRatioJitter()
+        : position_(golden_ratio_start().fetch_add(GOLDEN_RATIO_STEP,
+                                                   std::memory_order_relaxed)) {
+    }
+
+    explicit GoldenRatioJitter(uint64_t seed)
+        : position_(SplitMix64(seed)()) {
+    }
+
+    template <typename Generator>
+    resolution
+        next(Generator&, resolution) {
+        position_ += GOLDEN_RATIO_STEP;
+        uint64_t low;
+        uint64_t offset = multiply_high(position_, uint64_t(Max - Min) + 1, low);
+        return resolution(Min + static_cast<resolution::rep>(offset));
+    }
+};
+
+
+/* Like GoldenRatioJitter, but every SharedGoldenRatioJitter in the process
+takes its jitters from one sequence, so the timers of a process spread out
+over the range together, as well as each one over its iterations. A draw is
+an atomic fetch_add on the shared position. */
+template <int Min, int Max>
+class SharedGoldenRatioJitter {
+public:
+    template <typename Generator>
+    resolution
+        next(Generator&, resolution) {
+        uint64_t position = shared_golden_ratio_position().fetch_add(
+            GOLDEN_RATIO_STEP, std::memory_order_relaxed) + GOLDEN_RATIO_STEP;
+        uint64_t low;
+        uint64_t offset = multiply_high(position, uint64_t(Max - Min) + 1, low);
+        return resolution(Min + static_cast<resolution::rep>(offset));
+    }
+};
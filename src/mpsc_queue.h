@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+
+/* An unbounded multi-producer, single-consumer queue (Vyukov's). Any number
+of threads can push() at the same time without a lock: a push is one atomic
+exchange and one store. Only one thread may pop().
+
+The queue always holds one node that has already been popped, or the initial
+dummy, and head_ is the node most recently pushed. A producer swaps its node
+into head_ first and links it behind the previous head second, so for a moment
+between the two a pushed node can't be popped yet. empty() counts that node,
+so a consumer that checks empty() before going to sleep doesn't miss it.
+*/
+template <typename T>
+class MpscQueue {
+    struct Node {
+        std::atomic<Node*>  next{nullptr};
+        T                   value;
+
+        Node() = default;
+        explicit Node(T&& item)
+            : value(std::move(item)) {
+        }
+    };
+
+    std::atomic<Node*>  head_;
+    // Only the consumer touches tail_
+    Node*               tail_;
+
+public:
+    MpscQueue() {
+        Node* dummy = new Node;
+        head_.store(dummy);
+        tail_ = dummy;
+    }
+
+    ~MpscQueue() {
+        T discard;
+        while (pop(discard)) {
+        }
+
+        delete tail_;
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    //! @brief add an item. Safe to call from any number of threads.
+    void
+        push(T item) {
+        Node* node = new Node(std::move(item));
+        Node* previous = head_.exchange(node);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    //! @brief take the oldest item. Returns false if there is none, or the
+    // next one is still being pushed. Only the consumer may call it.
+    bool
+        pop(T& item) {
+        Node* next = tail_->next.load(std::memory_order_acquire);
+        if (next == nullptr) {
+            return false;
+        }
+
+        item = std::move(next->value);
+        delete tail_;
+        tail_ = next;
+        return true;
+    }
+
+    //! @brief true if nothing has been pushed that hasn't been popped. Only
+    // the consumer may call it.
+    bool
+        empty() const {
+        return head_.load() == tail_;
+    }
+};
@@ -0,0 +1,600 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <random>
+#include <thread>
+#include <iostream>
+#include <iomanip>
+
+#include "intervals.h"
+#include "platform.h"
+#include "histogram.h"
+#include "cost_estimate.h"
+#include "random.h"
+#include "jitter.h"
+#include "sleepers.h"
+#include "clocks.h"
+#include "real_time.h"
+
+
+/* What doItTimed does when it falls one or more whole intervals behind, for
+example after do_it overran or the thread was stalled.
+*/
+enum class Overrun {
+    // Run every missed tick back-to-back until it has caught up
+    CATCH_UP,
+    // Drop the missed ticks and wait for the next slot that's still ahead
+    SKIP,
+    // Run at most max_catch_up missed ticks back-to-back and drop the rest
+    BURST,
+    // Make one call for all of the missed ticks, which is told how many ticks
+    // it covers. A tick is only missed once its start plus jitter has passed.
+    COALESCE
+};
+
+
+/* Ticks that an overrun policy handled, of the last run. */
+struct OverrunStats {
+    // Missed ticks run back-to-back, by CATCH_UP or BURST
+    uint64_t    caught_up_ticks = 0;
+    // Missed ticks dropped, by SKIP or BURST
+    uint64_t    skipped_ticks = 0;
+    // Missed ticks folded into another tick's call, by COALESCE
+    uint64_t    coalesced_ticks = 0;
+};
+
+
+/* Bounds for adaptive mode, in which doItTimed stretches its interval while
+do_it keeps taking up too much of it, and shrinks it back toward the nominal
+interval once do_it speeds up again. Load is do_it's average duration (an
+EWMA) as a share of the current interval.
+*/
+struct AdaptiveInterval {
+    // The longest the interval may stretch to. Adaptive mode is off unless
+    // it's longer than the timer's interval.
+    resolution  max_interval{0};
+    // Stretch after the load has been above high_load for patience
+    // iterations in a row, and shrink after it has been below low_load
+    double      high_load = 0.9;
+    double      low_load = 0.5;
+    uint32_t    patience = 8;
+};
+
+
+/* Call a function once per interval, at the start of the interval plus a
+random jitter drawn from a Jitter (see jitter.h).
+
+Use it through PeriodicTimer<IntervalMin, IntervalMax>, whose jitter range is
+fixed at compile time, or RuntimePeriodicTimer, whose range and shape are set
+per timer with jitter().set(), from any thread, even while it runs. The other
+policies in jitter.h are used as BasicPeriodicTimer<FullJitter> and so on. The
+interval can be changed with set_interval() in both, and applies from the next
+interval on.
+
+Between calls the timer thread sleeps with a Sleeper (see sleepers.h). The
+default, ConditionSleeper, waits on a condition variable rather than in
+sleep_until, so stop() wakes it right away instead of waiting out the rest of
+the interval. On Linux, NanosleepSleeper sleeps in clock_nanosleep on the
+absolute deadline instead. The Sleeper is also the timer's clock, and with
+VirtualSleeper the timer runs on a virtual clock that jumps straight to each
+deadline, to simulate a long schedule in a moment. To read a different clock
+source, such as CLOCK_MONOTONIC_COARSE, wrap the sleeper in ClockedSleeper
+(see clocks.h). An iteration reads the clock once after do_it, and once more
+only if it waited.
+
+The OS usually wakes a sleeping thread tens of microseconds late, or more, and
+that overshoot is added to the jitter. In precision mode, set_precision(guard),
+the thread only sleeps until guard before the deadline and spins the rest of
+the way, which costs the CPU for the guard window of every iteration.
+
+For the lowest jitter, set_real_time() runs the timer thread with SCHED_FIFO
+priority, locked memory and a CPU of its own, as far as the process is
+allowed to; real_time_status() says which settings took. The thread's
+scheduling and CPU are put back when the run ends, but the memory lock is
+the process's and stays.
+
+Every iteration records how late it started, and how long do_it ran, in a
+LatencyHistogram, which is cheap enough to leave on; see lateness(). With the
+sleeper's wakeup lateness that's three histograms, which are allocated on a
+run's first iteration, about 14.6 KB together, on top of the timer itself.
+set_statistics(false) turns all three off, so a run allocates nothing.
+
+After an overrun or a stall, the timer catches up on every tick it missed by
+default. set_overrun() chooses another policy; see Overrun. When do_it keeps
+taking longer than the interval, set_adaptive() lets the interval stretch
+instead, so the loop doesn't run back-to-back for good; see AdaptiveInterval.
+
+The jitter is drawn with a Generator, xoshiro256++ by default (see random.h),
+which the timer seeds once and keeps from run to run.
+*/
+template <typename Jitter, typename Sleeper = ConditionSleeper,
+          typename Generator = Xoshiro256pp>
+class BasicPeriodicTimer {
+private:
+    // The nominal interval, which set_interval() can change while it runs
+    std::atomic<resolution::rep> interval_;
+    Jitter                  jitter_;
+    Generator               gen_;
+    std::atomic<bool>       is_running_{false};
+    // stop() interrupts it to end the wait for the next iteration
+    Sleeper                 sleeper_;
+    std::future<int>        pending_;
+    // Sleep until this long before a deadline, then spin. 0 means only sleep.
+    resolution              guard_{0};
+    // How late each iteration started, and how long do_it ran, of the last run
+    LatencyHistogram        lateness_;
+    LatencyHistogram        execution_times_;
+    // Whether a run fills the histograms
+    bool                    statistics_ = true;
+    Overrun                 overrun_ = Overrun::CATCH_UP;
+    uint64_t                max_catch_up_ = 1;
+    OverrunStats            overrun_stats_;
+    AdaptiveInterval        adaptive_;
+    // The interval doItTimed is using, which adaptive mode changes
+    std::atomic<resolution::rep> effective_interval_;
+    // do_it's durations, and how many iterations in a row the load has been
+    // above high_load or below low_load, in adaptive mode
+    CostEstimate            cost_;
+    uint32_t                overloaded_run_ = 0;
+    uint32_t                relaxed_run_ = 0;
+    RealTimeConfig          real_time_;
+    RealTimeStatus          real_time_status_;
+    /* Record the time if the first and last intervals to calculate the total
+    time in which do_it() is executed.
+    */
+    my_clock::time_point    interval_first_;
+    my_clock::time_point    interval_last_;
+
+    //! @brief wait until time, and return true, or until is_running is
+    // cleared, and return false.
+    bool wait_until(my_clock::time_point time,
+                    const std::atomic<bool>& is_running) {
+        if (!sleeper_.sleep_until(time - guard_, is_running)) {
+            return false;
+        }
+
+        if (guard_.count() == 0) {
+            // The sleeper has seen the deadline pass, whatever a coarser
+            // clock says
+            return true;
+        }
+
+        while (sleeper_.now() < time) {
+            if (!is_running.load()) {
+                return false;
+            }
+
+            sleeper_.relax();
+        }
+
+        return true;
+    }
+
+    //! @brief the interval to use after an iteration in which do_it ran for
+    // took, in adaptive mode. It moves toward the interval that puts the load
+    // halfway between low_load and high_load, within the configured bounds,
+    // and is never shorter than the nominal interval.
+    resolution adapt(resolution interval, resolution nominal, duration took) {
+        cost_.insert(took);
+        double load = static_cast<double>(cost_.average().count())
+            / static_cast<double>(interval.count());
+        overloaded_run_ = load > adaptive_.high_load ? overloaded_run_ + 1 : 0;
+        relaxed_run_ = load < adaptive_.low_load ? relaxed_run_ + 1 : 0;
+        if (overloaded_run_ < adaptive_.patience
+            && relaxed_run_ < adaptive_.patience) {
+            return std::max(interval, nominal);
+        }
+
+        overloaded_run_ = 0;
+        relaxed_run_ = 0;
+        double target_load = (adaptive_.high_load + adaptive_.low_load) / 2;
+        resolution target(static_cast<resolution::rep>(
+            static_cast<double>(cost_.average().count()) / target_load));
+        return std::min(std::max(target, nominal), adaptive_.max_interval);
+    }
+
+    //! @brief print the missed intervals, how long do_it ran and how late
+    // it started, for the run that just ended.
+    void report(int missed_intervals) const {
+        std::cout << "Missed intervals:           " << std::setw(DWIDTH)
+            << std::setfill(' ') << missed_intervals << std::endl;
+        std::cout << "Shortest execution time is  " << std::setw(DWIDTH)
+            << std::setfill(' ') << execution_times_.smallest().count()
+            << " ns" << std::endl;
+        std::cout << "Longest execution time is   " << std::setw(DWIDTH)
+            << std::setfill(' ') << execution_times_.largest().count()
+            << " ns" << std::endl;
+        std::cout << "Average execution time is   " << std::setw(DWIDTH)
+            << std::setfill(' ') << execution_times_.average().count()
+            << " ns" << std::endl;
+        std::cout << "Median execution time is:   " << std::setw(DWIDTH)
+            << std::setfill(' ') << execution_times_.percentile(0.5).count()
+            << " ns" << std::endl;
+        std::cout << "Shortest lateness is        " << std::setw(DWIDTH)
+            << std::setfill(' ')
+            << std::chrono::duration_cast<microsec>(
+                lateness_.smallest()).count()
+            << " us" << std::endl;
+        std::cout << "Longest lateness is         " << std::setw(DWIDTH)
+            << std::setfill(' ')
+            << std::chrono::duration_cast<microsec>(
+                lateness_.largest()).count()
+            << " us" << std::endl;
+        std::cout << "Average lateness is         " << std::setw(DWIDTH)
+            << std::setfill(' ')
+            << std::chrono::duration_cast<microsec>(
+                lateness_.average()).count()
+            << " us" << std::endl;
+        std::cout << "p99 lateness is             " << std::setw(DWIDTH)
+            << std::setfill(' ')
+            << std::chrono::duration_cast<microsec>(
+                lateness_.percentile(0.99)).count()
+            << " us" << std::endl;
+        std::cout << "p99.9 lateness is           " << std::setw(DWIDTH)
+            << std::setfill(' ')
+            << std::chrono::duration_cast<microsec>(
+                lateness_.percentile(0.999)).count()
+            << " us" << std::endl << std::endl;
+    }
+
+    //! @brief call do_it until stop() is called, and return the number of
+    // iterations for which do_it was called. do_it's second argument is the
+    // number of ticks the call covers, which is 1 unless ticks were coalesced.
+    int doItTimed(std::function<void(duration, uint64_t)> do_it) {
+        lateness_ = LatencyHistogram();
+        execution_times_ = LatencyHistogram();
+        sleeper_.reset(statistics_);
+        overrun_stats_ = OverrunStats();
+        // Until the run ends
+        RealTimeScope real_time(real_time_);
+        real_time_status_ = real_time.status();
+        cost_ = CostEstimate();
+        overloaded_run_ = 0;
+        relaxed_run_ = 0;
+        resolution interval = this->interval();
+        const bool adaptive = adaptive_.max_interval > interval;
+        effective_interval_.store(interval.count());
+        int result = 0;
+        int missed_intervals = 0;
+        resolution jitter = jitter_.next(gen_, interval);
+        my_clock::time_point time_current;
+        my_clock::time_point time_start_do_it;
+
+        // Set the time of the first interval
+        interval_first_ = sleeper_.now();
+        my_clock::time_point interval_current_start{interval_first_};
+        my_clock::time_point interval_next_start{interval_current_start + interval};
+        my_clock::time_point time_do_it = interval_current_start + jitter;
+        // Each iteration starts with the reading taken after the last do_it,
+        // so there's only one more when it waits and none when it doesn't
+        time_current = interval_first_;
+
+        while (is_running_.load()) {
+            uint64_t ticks = 1;
+            // SKIP also drops the slot it's in once its jitter has passed. A
+            // slot that starts right now hasn't, so it's run.
+            if (time_current >= interval_next_start
+                || (overrun_ == Overrun::SKIP && time_current > time_do_it)) {
+                // Whole intervals that have passed since this one began
+                uint64_t behind = static_cast<uint64_t>(
+                    (time_current - interval_current_start) / interval);
+                // Whether the slot now is in has passed its jitter already
+                bool passed = interval_current_start
+                    + interval * static_cast<resolution::rep>(behind)
+                    + jitter < time_current;
+                uint64_t dropped = 0;
+                if (overrun_ == Overrun::SKIP) {
+                    dropped = passed ? behind + 1 : behind;
+                } else if (overrun_ == Overrun::BURST && behind > max_catch_up_) {
+                    dropped = behind - max_catch_up_;
+                } else if (overrun_ == Overrun::COALESCE) {
+                    // Leave the slot now is in for its own call, unless its
+                    // jitter has passed
+                    uint64_t coalesced = passed ? behind : behind - 1;
+                    ticks += coalesced;
+                    overrun_stats_.coalesced_ticks += coalesced;
+                }
+
+                if (dropped > 0) {
+                    overrun_stats_.skipped_ticks += dropped;
+                    interval_current_start +=
+                        interval * static_cast<resolution::rep>(dropped);
+                    interval_next_start = interval_current_start + interval;
+                    time_do_it = interval_current_start + jitter;
+                }
+
+                if (overrun_ == Overrun::CATCH_UP || overrun_ == Overrun::BURST) {
+                    if (behind > dropped) {
+                        ++overrun_stats_.caught_up_ticks;
+                    }
+                }
+            }
+
+            if (time_current < time_do_it) {
+                // Wait for the next interval + jitter, unless stop() is called
+                if (!wait_until(time_do_it, is_running_)) {
+                    break;
+                }
+
+                // Get current time to more accurately measure do_it()'s duration
+                time_start_do_it = sleeper_.now();
+            } else {
+                // Run do_it immediately, and count the interval as missed
+                // unless it's due right now
+                if (time_current > time_do_it) {
+                    ++missed_intervals;
+                }
+
+                time_start_do_it = time_current;
+            }
+
+            if (statistics_) {
+                lateness_.insert(time_start_do_it - time_do_it);
+            }
+
+            do_it(jitter, ticks);
+
+            // Record the duration of do_it
+            time_current = sleeper_.now();
+            if (statistics_) {
+                execution_times_.insert(time_current - time_start_do_it);
+            }
+
+            // Update the iteration count
+            ++result;
+
+            // Update the start times for the next interval, past every tick
+            // this call covered
+            interval_current_start +=
+                interval * static_cast<resolution::rep>(ticks);
+            if (adaptive) {
+                interval = adapt(interval, this->interval(),
+                                 time_current - time_start_do_it);
+            } else {
+                interval = this->interval();
+            }
+
+            effective_interval_.store(interval.count(),
+                                      std::memory_order_relaxed);
+
+            // Get a new jitter for the next iteration
+            jitter = jitter_.next(gen_, interval);
+
+            interval_next_start = interval_current_start + interval;
+            time_do_it = interval_current_start + jitter;
+        }
+
+        interval_last_ = interval_current_start;
+        report(missed_intervals);
+
+        return result;
+    }
+
+public:
+    explicit BasicPeriodicTimer(resolution interval = INTERVAL_PERIOD)
+        : interval_(interval.count())
+        , gen_(random_seed())
+        , effective_interval_(interval.count()) {
+    }
+
+    //! @brief the nominal interval. Safe to call while the timer runs.
+    resolution interval() const {
+        return resolution(interval_.load(std::memory_order_relaxed));
+    }
+
+    //! @brief change the interval from the next one on. Safe to call from any
+    // thread while the timer runs.
+    void set_interval(resolution interval) {
+        interval_.store(interval.count(), std::memory_order_relaxed);
+    }
+
+    //! @brief how the timer sleeps and tells the time, for example to
+    // advance() a VirtualSleeper from do_it.
+    Sleeper& sleeper() {
+        return sleeper_;
+    }
+
+    //! @brief where the timer gets its jitter. A RuntimeJitter can be changed
+    // through it from any thread while the timer runs.
+    Jitter& jitter() {
+        return jitter_;
+    }
+
+    //! @brief sleep until guard before each deadline and spin from there
+    // (precision mode), or only sleep if guard is 0. Set it before a run.
+    void set_precision(resolution guard) {
+        guard_ = guard;
+    }
+
+    //! @brief whether a run records lateness(), execution_times() and
+    // wakeup_lateness(). Turning it off saves their 14.6 KB per running timer
+    // and a little time per iteration. Set it before a run.
+    void set_statistics(bool enabled) {
+        statistics_ = enabled;
+    }
+
+    //! @brief run the timer thread with the real-time settings in config.
+    // Set it before starting the timer.
+    void set_real_time(const RealTimeConfig& config) {
+        real_time_ = config;
+    }
+
+    //! @brief let doItTimed stretch its interval under sustained overload,
+    // up to bounds.max_interval, and shrink it back once do_it recovers. Set
+    // it before a run.
+    void set_adaptive(const AdaptiveInterval& bounds) {
+        adaptive_ = bounds;
+    }
+
+    //! @brief the interval doItTimed is using now, which differs from the
+    // nominal interval only in adaptive mode. Safe to call while it runs.
+    resolution effective_interval() const {
+        return resolution(effective_interval_.load());
+    }
+
+    //! @brief choose what doItTimed does when it falls behind. max_catch_up
+    // is the longest burst of missed ticks for Overrun::BURST. Set it before
+    // a run.
+    void set_overrun(Overrun policy, uint64_t max_catch_up = 1) {
+        overrun_ = policy;
+        max_catch_up_ = max_catch_up;
+    }
+
+    //! @brief call do_it for repeat_count iterations. 
+    // A random delay (jitter) is calculated for each call to do_it. If do_it
+    // runs for less than the delay, doItCounted will wait for the remaining time
+    // before the next interval. If do_it takes more time than the delay, the
+    // next iteration takes place immediately. This way, do_it is called no more
+    // often than
+    void doItCounted(std::function<void(resolution)> do_it,
+                     uint32_t repeat_count) {
+        lateness_ = LatencyHistogram();
+        execution_times_ = LatencyHistogram();
+        sleeper_.reset(statistics_);
+        // A counted run isn't stopped by stop()
+        const std::atomic<bool> is_running{true};
+        int missed_intervals = 0;
+        resolution jitter = jitter_.next(gen_, interval());
+        my_clock::time_point time_current;
+        my_clock::time_point time_start_do_it;
+
+        // Set the time of the first interval
+        interval_first_ = sleeper_.now();
+        my_clock::time_point interval_current_start{interval_first_};
+        my_clock::time_point interval_next_start{interval_current_start + interval()};
+        my_clock::time_point time_do_it = interval_current_start + jitter;
+
+        // As in doItTimed, reuse the reading taken after the last do_it
+        time_current = interval_first_;
+
+        uint32_t itr = 0;
+        while (itr < repeat_count) {
+            if (time_current < time_do_it) {
+                // Sleep until jitter ns beyond the interval, or until the
+                // guard window before it and spin from there
+                wait_until(time_do_it, is_running);
+                time_start_do_it = sleeper_.now();
+            } else {
+                if (time_current > time_do_it) {
+                    ++missed_intervals;
+                }
+
+                time_start_do_it = time_current;
+            }
+
+            if (statistics_) {
+                lateness_.insert(time_start_do_it - time_do_it);
+            }
+
+            do_it(jitter);
+            // Collect some stats
+            time_current = sleeper_.now();
+            if (statistics_) {
+                execution_times_.insert(time_current - time_start_do_it);
+            }
+            ++itr;
+
+            // Update the start times for the next interval
+            interval_current_start = interval_next_start;
+            interval_next_start += interval();
+
+            // Get a new jitter for the next iteration
+            jitter = jitter_.next(gen_, interval_next_start
+                                  - interval_current_start);
+            time_do_it = interval_current_start + jitter;
+        }
+
+        interval_last_ = interval_current_start;
+        report(missed_intervals);
+    }
+
+    void interval_current_start(std::function<void(resolution)> do_it) {
+        interval_current_start_ticks([do_it](resolution jitter, uint64_t) {
+            do_it(jitter);
+        });
+    }
+
+    //! @brief like interval_current_start, but do_it is also told how many
+    // ticks each call covers, which is more than 1 when Overrun::COALESCE
+    // folds missed ticks into it.
+    void interval_current_start_ticks(
+        std::function<void(resolution, uint64_t)> do_it) {
+        is_running_.store(true);
+        // Run doItTimed on another thread, passing the "this" pointer and the
+        // function doItTimed must run until stop() is executed.
+        auto f = std::async(std::launch::async,
+                            &BasicPeriodicTimer::doItTimed,
+                            this,
+                            do_it);
+        // Move the future to another variable so we don't wait for it here.
+        pending_ = std::move(f);
+    }
+
+    //! @brief stop calling do_it, and return the number of iterations. It
+    // returns as soon as a do_it that's running returns, without waiting for
+    // the next interval.
+    int stop() {
+        // Allow doItTimed to exit its while-loop
+        is_running_.store(false);
+        sleeper_.interrupt();
+
+        // Return the number of iterations
+        return pending_.get();
+    }
+
+    //! @brief how late each iteration of the last run started after its
+    // interval start plus jitter. Read it once the run is over.
+    const LatencyHistogram& lateness() const {
+        return lateness_;
+    }
+
+    //! @brief how long do_it ran on each iteration of the last run. Read it
+    // once the run is over.
+    const LatencyHistogram& execution_times() const {
+        return execution_times_;
+    }
+
+    //! @brief the ticks the overrun policy handled in the last run. Read it
+    // once the run is over.
+    const OverrunStats& overrun_stats() const {
+        return overrun_stats_;
+    }
+
+    //! @brief how far past the deadline each of the last run's sleeps woke
+    // up, as the sleeper measured it. In precision mode the deadline is the
+    // start of the guard window.
+    const LatencyHistogram& wakeup_lateness() const {
+        return sleeper_.lateness();
+    }
+
+    //! @brief which real-time settings the last run applied, and why the
+    // others failed. Read it once the run is over.
+    const RealTimeStatus& real_time_status() const {
+        return real_time_status_;
+    }
+
+    my_clock::duration runtime() const {
+        return interval_last_ - interval_first_;
+    }
+};
+
+
+/* A timer with a uniform jitter in [IntervalMin, IntervalMax] ns, fixed at
+compile time. */
+template <int IntervalMin, int IntervalMax,
+          typename Sleeper = ConditionSleeper,
+          typename Generator = Xoshiro256pp>
+using PeriodicTimer = BasicPeriodicTimer<StaticJitter<IntervalMin, IntervalMax>,
+                                         Sleeper, Generator>;
+
+
+/* A timer whose jitter range and shape are set, and can be changed, at run
+time. */
+template <typename Sleeper = ConditionSleeper,
+          typename Generator = Xoshiro256pp>
+using RuntimePeriodicTimer = BasicPeriodicTimer<RuntimeJitter, Sleeper,
+                                                Generator>;
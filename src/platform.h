@@ -0,0 +1,242 @@
+#pragma once
+
+/* The few things the timers need from the operating system that the C++
+standard library doesn't provide.
+*/
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <intrin.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/prctl.h>
+#include <sys/mman.h>
+#include <cerrno>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#include <cstdint>
+#include <chrono>
+#include <thread>
+
+
+//! @brief the number of CPUs the timers can spread across, at least 1.
+inline unsigned
+    cpu_count() {
+    unsigned count = std::thread::hardware_concurrency();
+    return count == 0 ? 1 : count;
+}
+
+
+//! @brief pin the calling thread to one CPU. Returns false if that isn't
+// possible, in which case the thread keeps running wherever the OS likes.
+inline bool
+    pin_current_thread(unsigned cpu) {
+#if defined(_WIN32)
+    if (cpu >= sizeof(DWORD_PTR) * 8) {
+        return false;
+    }
+
+    DWORD_PTR mask = DWORD_PTR(1) << cpu;
+    return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#elif defined(__linux__)
+    if (cpu >= CPU_SETSIZE) {
+        return false;
+    }
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+
+#if defined(__linux__)
+//! @brief convert a steady_clock time point to a timespec on CLOCK_MONOTONIC.
+// steady_clock is CLOCK_MONOTONIC in both libstdc++ and libc++.
+inline timespec
+    to_monotonic_timespec(std::chrono::steady_clock::time_point time) {
+    auto since_epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        time.time_since_epoch());
+    timespec result;
+    result.tv_sec = static_cast<time_t>(since_epoch.count() / 1000000000);
+    result.tv_nsec = static_cast<long>(since_epoch.count() % 1000000000);
+    return result;
+}
+
+
+//! @brief the opposite of to_monotonic_timespec.
+inline std::chrono::steady_clock::time_point
+    from_monotonic_timespec(const timespec& time) {
+    return std::chrono::steady_clock::time_point(std::chrono::nanoseconds(
+        int64_t(time.tv_sec) * 1000000000 + time.tv_nsec));
+}
+#endif
+
+
+//! @brief let the OS wake the calling thread up to slack later than it asked
+// for, so it can coalesce the thread's wakeups with others. Returns false
+// where that isn't supported.
+inline bool
+    set_current_thread_timer_slack(std::chrono::nanoseconds slack) {
+#if defined(__linux__)
+    // A slack of 0 would reset it to the default instead
+    unsigned long value = slack.count() > 0
+        ? static_cast<unsigned long>(slack.count()) : 1;
+    return prctl(PR_SET_TIMERSLACK, value, 0, 0, 0) == 0;
+#else
+    (void)slack;
+    return false;
+#endif
+}
+
+
+//! @brief run the calling thread with real-time, first-in first-out
+// scheduling at priority (1 to 99 on Linux; on Windows any priority means
+// THREAD_PRIORITY_TIME_CRITICAL). Returns 0, or the error code (an errno
+// value, or GetLastError() on Windows), typically because it isn't allowed.
+inline int
+    set_current_thread_fifo(int priority) {
+#if defined(_WIN32)
+    (void)priority;
+    return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL)
+        ? 0 : static_cast<int>(GetLastError());
+#elif defined(__linux__)
+    sched_param param = {};
+    param.sched_priority = priority;
+    return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+#else
+    (void)priority;
+    return ENOSYS;
+#endif
+}
+
+
+/* The calling thread's scheduling policy, priority and CPU affinity, as
+save_current_thread() found them, for restore_current_thread() to put back.
+*/
+struct ThreadSettings {
+#if defined(_WIN32)
+    int         priority = THREAD_PRIORITY_NORMAL;
+    DWORD_PTR   affinity = 0;
+#elif defined(__linux__)
+    int         policy = SCHED_OTHER;
+    sched_param param = {};
+    cpu_set_t   cpus;
+    bool        have_cpus = false;
+#endif
+};
+
+
+//! @brief the calling thread's scheduling and CPU affinity.
+inline ThreadSettings
+    save_current_thread() {
+    ThreadSettings result;
+#if defined(_WIN32)
+    result.priority = GetThreadPriority(GetCurrentThread());
+    // Windows only reports a thread's affinity by replacing it, so set it to
+    // the process's and back
+    DWORD_PTR process_mask;
+    DWORD_PTR system_mask;
+    if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask)) {
+        result.affinity = SetThreadAffinityMask(GetCurrentThread(), process_mask);
+        if (result.affinity != 0) {
+            SetThreadAffinityMask(GetCurrentThread(), result.affinity);
+        }
+    }
+#elif defined(__linux__)
+    pthread_getschedparam(pthread_self(), &result.policy, &result.param);
+    result.have_cpus = pthread_getaffinity_np(pthread_self(),
+                                              sizeof(result.cpus),
+                                              &result.cpus) == 0;
+#endif
+    return result;
+}
+
+
+//! @brief put back the calling thread's scheduling and CPU affinity as they
+// were saved. Dropping from real-time scheduling needs no privileges.
+inline void
+    restore_current_thread(const ThreadSettings& settings) {
+#if defined(_WIN32)
+    SetThreadPriority(GetCurrentThread(), settings.priority);
+    if (settings.affinity != 0) {
+        SetThreadAffinityMask(GetCurrentThread(), settings.affinity);
+    }
+#elif defined(__linux__)
+    pthread_setschedparam(pthread_self(), settings.policy, &settings.param);
+    if (settings.have_cpus) {
+        pthread_setaffinity_np(pthread_self(), sizeof(settings.cpus),
+                               &settings.cpus);
+    }
+#else
+    (void)settings;
+#endif
+}
+
+
+//! @brief lock every page of the process, now and in future, into memory so
+// a page fault can't delay a timer. It stays locked until the process ends.
+// Returns 0, or the error code.
+inline int
+    lock_process_memory() {
+#if defined(_WIN32)
+    // Windows can only lock ranges of pages, not the whole process
+    return ERROR_NOT_SUPPORTED;
+#elif defined(__linux__)
+    return mlockall(MCL_CURRENT | MCL_FUTURE) == 0 ? 0 : errno;
+#else
+    return ENOSYS;
+#endif
+}
+
+
+//! @brief the CPU time used by every thread of this process so far.
+inline std::chrono::nanoseconds
+    process_cpu_time() {
+#if defined(_WIN32)
+    FILETIME created;
+    FILETIME exited;
+    FILETIME kernel;
+    FILETIME user;
+    GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user);
+    // FILETIMEs count 100 ns units
+    uint64_t total = ((uint64_t(kernel.dwHighDateTime) << 32) | kernel.dwLowDateTime)
+        + ((uint64_t(user.dwHighDateTime) << 32) | user.dwLowDateTime);
+    return std::chrono::nanoseconds(total * 100);
+#elif defined(__linux__)
+    timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return std::chrono::seconds(now.tv_sec) + std::chrono::nanoseconds(now.tv_nsec);
+#else
+    return std::chrono::nanoseconds(0);
+#endif
+}
+
+
+//! @brief tell the CPU the calling thread is spinning, so it saves power and
+// gives a sibling hyperthread more of the core.
+inline void
+    cpu_relax() {
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(_M_ARM64)
+    __yield();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+}
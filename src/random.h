@@ -0,0 +1,312 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <random>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+/* Small, fast random number generators for drawing jitter, and bounded
+sampling without a division on almost every draw.
+
+Each generator is a UniformRandomBitGenerator, so it also works with the
+standard distributions, and each is seeded with one 64-bit number. Their
+whole state is 8 to 32 bytes, against about 5 KB for std::mt19937, and a draw
+is a handful of arithmetic instructions. None of them is suitable for
+cryptography.
+*/
+
+
+//! @brief a seed from std::random_device, for generators that aren't given
+// one.
+inline uint64_t
+    random_seed() {
+    std::random_device device;
+    return uint64_t(device()) << 32 | device();
+}
+
+
+//! @brief the high 64 bits of the 128-bit product of a and b, and the low
+// 64 bits in low.
+inline uint64_t
+    multiply_high(uint64_t a, uint64_t b, uint64_t& low) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    uint64_t high;
+    low = _umul128(a, b, &high);
+    return high;
+#elif defined(_MSC_VER) && defined(_M_ARM64)
+    low = a * b;
+    return __umulh(a, b);
+#elif defined(__SIZEOF_INT128__)
+    unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+    low = static_cast<uint64_t>(product);
+    return static_cast<uint64_t>(product >> 64);
+#else
+    // 32-bit builds: add up the four 32x32-bit products
+    uint64_t a_low = a & 0xffffffff;
+    uint64_t a_high = a >> 32;
+    uint64_t b_low = b & 0xffffffff;
+    uint64_t b_high = b >> 32;
+    uint64_t low_low = a_low * b_low;
+    uint64_t high_low = a_high * b_low;
+    uint64_t low_high = a_low * b_high;
+    uint64_t high_high = a_high * b_high;
+    uint64_t middle = (low_low >> 32) + (high_low & 0xffffffff) + low_high;
+    low = a * b;
+    return high_high + (high_low >> 32) + (middle >> 32);
+#endif
+}
+
+
+//! @brief a * b / c, rounded down, from the full 128-bit product. The
+// quotient fits in 64 bits as long as a < c.
+inline uint64_t
+    multiply_divide(uint64_t a, uint64_t b, uint64_t c) {
+    uint64_t low;
+    uint64_t high = multiply_high(a, b, low);
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 product = static_cast<unsigned __int128>(high) << 64 | low;
+    return static_cast<uint64_t>(product / c);
+#else
+    // Long division a bit at a time, keeping the remainder in high
+    uint64_t quotient = 0;
+    for (int bit = 0; bit < 64; ++bit) {
+        bool carry = (high >> 63) != 0;
+        high = high << 1 | low >> 63;
+        low <<= 1;
+        quotient <<= 1;
+        if (carry || high >= c) {
+            high -= c;
+            quotient |= 1;
+        }
+    }
+
+    return quotient;
+#endif
+}
+
+
+/* SplitMix64, which turns one 64-bit seed into as many well mixed 64-bit
+numbers as the other generators need for their state. */
+class SplitMix64 {
+    uint64_t    state_;
+
+public:
+    using result_type = uint64_t;
+
+    explicit SplitMix64(uint64_t seed = random_seed())
+        : state_(seed) {
+    }
+
+    static constexpr result_type
+        min() {
+        return 0;
+    }
+
+    static constexpr result_type
+        max() {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type
+        operator()() {
+        uint64_t z = (state_ += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+};
+
+
+/* xoshiro256++ by Blackman and Vigna: 32 bytes of state, 64 bits per draw,
+and a period of 2^256 - 1. The default generator of the timers. */
+class Xoshiro256pp {
+    uint64_t    state_[4];
+
+    static uint64_t
+        rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+public:
+    using result_type = uint64_t;
+
+    explicit Xoshiro256pp(uint64_t seed = random_seed()) {
+        SplitMix64 mix(seed);
+        for (uint64_t& word : state_) {
+            word = mix();
+        }
+    }
+
+    static constexpr result_type
+        min() {
+        return 0;
+    }
+
+    static constexpr result_type
+        max() {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type
+        operator()() {
+        uint64_t result = rotl(state_[0] + state_[3], 23) + state_[0];
+        uint64_t t = state_[1] << 17;
+        state_[2] ^= state_[0];
+        state_[3] ^= state_[1];
+        state_[1] ^= state_[2];
+        state_[0] ^= state_[3];
+        state_[2] ^= t;
+        state_[3] = rotl(state_[3], 45);
+        return result;
+    }
+};
+
+
+/* PCG32 (XSH-RR) by O'Neill: 16 bytes of state and 32 bits per draw. */
+class Pcg32 {
+    uint64_t    state_ = 0;
+    uint64_t    increment_;
+
+    void
+        step() {
+        state_ = state_ * 6364136223846793005ULL + increment_;
+    }
+
+public:
+    using result_type = uint32_t;
+
+    explicit Pcg32(uint64_t seed = random_seed(), uint64_t stream = 1)
+        : increment_(stream << 1 | 1) {
+        step();
+        state_ += seed;
+        step();
+    }
+
+    static constexpr result_type
+        min() {
+        return 0;
+    }
+
+    static constexpr result_type
+        max() {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type
+        operator()() {
+        uint64_t old = state_;
+        step();
+        uint32_t shifted = static_cast<uint32_t>(((old >> 18) ^ old) >> 27);
+        uint32_t rotation = static_cast<uint32_t>(old >> 59);
+        return (shifted >> rotation) | (shifted << ((32 - rotation) & 31));
+    }
+};
+
+
+/* wyrand by Wang Yi: 8 bytes of state and 64 bits per draw, from one
+addition and one 64x64-bit multiplication. */
+class Wyrand {
+    uint64_t    state_;
+
+public:
+    using result_type = uint64_t;
+
+    explicit Wyrand(uint64_t seed = random_seed())
+        : state_(seed) {
+    }
+
+    static constexpr result_type
+        min() {
+        return 0;
+    }
+
+    static constexpr result_type
+        max() {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type
+        operator()() {
+        state_ += 0xa0761d6478bd642fULL;
+        uint64_t low;
+        uint64_t high = multiply_high(state_, state_ ^ 0xe7037ed1a0b428dbULL,
+                                      low);
+        return high ^ low;
+    }
+};
+
+
+//! @brief 64 random bits from gen, from two draws if it only gives 32.
+template <typename Generator>
+uint64_t
+    random_bits(Generator& gen) {
+    static_assert(Generator::min() == 0, "the generator must start at 0");
+    if (Generator::max() == std::numeric_limits<uint32_t>::max()) {
+        uint64_t high = static_cast<uint32_t>(gen());
+        return high << 32 | static_cast<uint32_t>(gen());
+    }
+
+    static_assert(Generator::max() == std::numeric_limits<uint32_t>::max()
+                  || Generator::max() == std::numeric_limits<uint64_t>::max(),
+                  "the generator must give 32 or 64 random bits");
+    return static_cast<uint64_t>(gen());
+}
+
+
+//! @brief a uniform random number in [0, bound), with Lemire's nearly
+// divisionless method: the high half of a random number times bound, with a
+// division only in the rare case that the low half shows the result may be
+// biased. A generator of 32 bits draws once for bounds that fit in 32 bits.
+// bound must not be 0.
+template <typename Generator>
+uint64_t
+    uniform_below(Generator& gen, uint64_t bound) {
+    if (Generator::max() == std::numeric_limits<uint32_t>::max()
+        && bound <= std::numeric_limits<uint32_t>::max()) {
+        uint32_t bound32 = static_cast<uint32_t>(bound);
+        uint64_t product = uint64_t(static_cast<uint32_t>(gen())) * bound32;
+        uint32_t low = static_cast<uint32_t>(product);
+        if (low < bound32) {
+            uint32_t threshold = (0 - bound32) % bound32;
+            while (low < threshold) {
+                product = uint64_t(static_cast<uint32_t>(gen())) * bound32;
+                low = static_cast<uint32_t>(product);
+            }
+        }
+
+        return product >> 32;
+    }
+
+    uint64_t low;
+    uint64_t high = multiply_high(random_bits(gen), bound, low);
+    if (low < bound) {
+        uint64_t threshold = (0 - bound) % bound;
+        while (low < threshold) {
+            high = multiply_high(random_bits(gen), bound, low);
+        }
+    }
+
+    return high;
+}
+
+
+//! @brief a uniform random number in [min, max].
+template <typename Generator>
+int64_t
+    uniform_in(Generator& gen, int64_t min, int64_t max) {
+    uint64_t span = static_cast<uint64_t>(max) - static_cast<uint64_t>(min) + 1;
+    uint64_t offset = span == 0 ? random_bits(gen) : uniform_below(gen, span);
+    return static_cast<int64_t>(static_cast<uint64_t>(min) + offset);
+}
+
+
+//! @brief a uniform random double in [0, 1), from the top 53 bits of a draw.
+template <typename Generator>
+double
+    uniform_unit(Generator& gen) {
+    return static_cast<double>(random_bits(gen) >> 11) * (1.0 / 9007199254740992.0);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "platform.h"
+
+
+/* Settings for a timer thread that needs the lowest jitter the OS can give:
+real-time FIFO scheduling, memory locked against page faults, and a CPU of
+its own. Each is off unless it's set. They usually need privileges, such as
+CAP_SYS_NICE and CAP_IPC_LOCK or root on Linux.
+
+The scheduling and the CPU are the thread's, and RealTimeScope puts them back
+when the run ends. The memory lock is the whole process's, and stays until
+the process ends: unlocking it could undo a lock someone else relies on.
+*/
+struct RealTimeConfig {
+    // SCHED_FIFO priority, 1 to 99. 0 leaves the scheduling alone.
+    int         fifo_priority = 0;
+    // mlockall(MCL_CURRENT | MCL_FUTURE), for the whole process and for good
+    bool        lock_memory = false;
+    // The CPU to pin the thread to. -1 lets it run anywhere.
+    int         cpu = -1;
+};
+
+
+/* Which real-time settings were applied. A setting that couldn't be applied
+is left off, and the reason is in failures; the thread runs anyway.
+*/
+struct RealTimeStatus {
+    bool                        fifo = false;
+    bool                        memory_locked = false;
+    bool                        pinned = false;
+    std::vector<std::string>    failures;
+};
+
+
+//! @brief apply config to the calling thread, as far as it can be applied.
+inline RealTimeStatus
+    apply_real_time(const RealTimeConfig& config) {
+    RealTimeStatus result;
+    if (config.lock_memory) {
+        int error = lock_process_memory();
+        result.memory_locked = error == 0;
+        if (error != 0) {
+            result.failures.push_back("lock memory: "
+                + std::system_category().message(error));
+        }
+    }
+
+    if (config.cpu >= 0) {
+        result.pinned = pin_current_thread(static_cast<unsigned>(config.cpu));
+        if (!result.pinned) {
+            result.failures.push_back("pin to CPU " + std::to_string(config.cpu)
+                + ": not possible on this system");
+        }
+    }
+
+    if (config.fifo_priority > 0) {
+        int error = set_current_thread_fifo(config.fifo_priority);
+        result.fifo = error == 0;
+        if (error != 0) {
+            result.failures.push_back("SCHED_FIFO priority "
+                + std::to_string(config.fifo_priority) + ": "
+                + std::system_category().message(error));
+        }
+    }
+
+    return result;
+}
+
+
+/* Applies a RealTimeConfig to the calling thread for as long as it lives, then
+puts the thread's scheduling and CPU affinity back. The thread may outlive the
+timer's run: with MSVC, std::async runs on a thread pool, and the next task on
+the thread shouldn't inherit a real-time priority or a pinned CPU.
+*/
+class RealTimeScope {
+    ThreadSettings          saved_;
+    bool                    changed_;
+    RealTimeStatus          status_;
+
+public:
+    explicit RealTimeScope(const RealTimeConfig& config)
+        : saved_(save_current_thread())
+        , changed_(config.fifo_priority > 0 || config.cpu >= 0)
+        , status_(apply_real_time(config)) {
+    }
+
+    ~RealTimeScope() {
+        if (changed_) {
+            restore_current_thread(saved_);
+        }
+    }
+
+    RealTimeScope(const RealTimeScope&) = delete;
+    RealTimeScope& operator=(const RealTimeScope&) = delete;
+
+    const RealTimeStatus&
+        status() const {
+        return status_;
+    }
+};
@@ -0,0 +1,755 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <condition_variable>
+#include <random>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <thread>
+
+#include "intervals.h"
+#include "platform.h"
+#include "histogram.h"
+#include "cost_estimate.h"
+#include "random.h"
+#include "block_generator.h"
+#include "mpsc_queue.h"
+#include "timer_node.h"
+#include "timing_wheel.h"
+#include "deadline_heap.h"
+#include "work_stealing_pool.h"
+#include "epoll_waiter.h"
+
+
+/* How much a timer's callback matters when a tick is overloaded. See
+Scheduler::set_admission(). */
+enum class Priority {
+    NORMAL,
+    // May be shed or deferred when admission control is on
+    LOW
+};
+
+
+/* What a scheduler does with a low-priority callback in an overloaded tick. */
+enum class Admission {
+    // Run every callback; admission control is off
+    OFF,
+    // Skip the callback for this interval
+    SHED,
+    // Run it after the tick's other callbacks, if it's still predicted to
+    // finish within its interval, and otherwise skip it
+    DEFER
+};
+
+
+/* Totals across the timers run by a scheduler. */
+struct SchedulerStats {
+    uint64_t        iterations = 0;
+    uint64_t        missed_intervals = 0;
+    // Times the scheduler thread woke up from a wait
+    uint64_t        wakeups = 0;
+    // Expirations that shared a wakeup with an earlier one in the same tick
+    uint64_t        merged_expirations = 0;
+    // Low-priority callbacks skipped by admission control, including deferred
+    // ones that no longer fit
+    uint64_t        shed = 0;
+    // Low-priority callbacks moved to the end of their tick
+    uint64_t        deferred = 0;
+    // How long do_it ran
+    DurationStats   durations;
+    // From the deadline (interval start plus jitter) until do_it started
+    LatencyHistogram dispatch_latency;
+
+    void
+        merge(const SchedulerStats& other) {
+        iterations += other.iterations;
+        missed_intervals += other.missed_intervals;
+        wakeups += other.wakeups;
+        merged_expirations += other.merged_expirations;
+        shed += other.shed;
+        deferred += other.deferred;
+        durations.merge(other.durations);
+        dispatch_latency.merge(other.dispatch_latency);
+    }
+};
+
+
+/* What one tick of a scheduler thread adds to its SchedulerStats. The
+latencies are kept as a list until the tick is merged, so a tick doesn't clear
+and merge a whole LatencyHistogram. The scheduler thread reuses one TickStats,
+which keeps the list's memory from tick to tick.
+*/
+struct TickStats {
+    uint64_t        iterations = 0;
+    uint64_t        missed_intervals = 0;
+    uint64_t        wakeups = 0;
+    uint64_t        merged_expirations = 0;
+    uint64_t        shed = 0;
+    uint64_t        deferred = 0;
+    DurationStats   durations;
+    std::vector<duration> dispatch_latency;
+
+    void
+        clear() {
+        iterations = 0;
+        missed_intervals = 0;
+        wakeups = 0;
+        merged_expirations = 0;
+        shed = 0;
+        deferred = 0;
+        durations = DurationStats();
+        dispatch_latency.clear();
+    }
+
+    void
+        merge_into(SchedulerStats& stats) const {
+        stats.iterations += iterations;
+        stats.missed_intervals += missed_intervals;
+        stats.wakeups += wakeups;
+        stats.merged_expirations += merged_expirations;
+        stats.shed += shed;
+        stats.deferred += deferred;
+        stats.durations.merge(durations);
+        for (duration latency : dispatch_latency) {
+            stats.dispatch_latency.insert(latency);
+        }
+    }
+};
+
+
+/* Put the scheduler thread to sleep until a deadline, or until notify() is
+called because a command was queued or the scheduler is stopping. A notify()
+that comes before the wait isn't lost; it ends the next wait right away.
+*/
+class ConditionWaiter {
+    std::mutex              mutex_;
+    std::condition_variable wakeup_;
+    bool                    notified_ = false;
+
+public:
+    void
+        wait_until(my_clock::time_point deadline) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (deadline == my_clock::time_point::max()) {
+            wakeup_.wait(lock, [this]() { return notified_; });
+        } else {
+            wakeup_.wait_until(lock, deadline, [this]() { return notified_; });
+        }
+
+        notified_ = false;
+    }
+
+    void
+        notify() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            notified_ = true;
+        }
+
+        wakeup_.notify_one();
+    }
+};
+
+
+/* Run many periodic timers on one thread. Each timer has its own interval and
+jitter range, and like PeriodicTimer::doItTimed, do_it is called at the start
+of each interval plus a random jitter. Missed intervals are counted
+differently, though: doItTimed counts one whenever the deadline has passed
+before it waits, but the scheduler only counts a callback that starts at or
+after the start of the timer's next interval, since it couldn't run within
+its own. A callback that's late but still within its interval shows up in the
+dispatch latency instead.
+
+The Backend orders the timers by deadline. TimingWheel suits many timers,
+and DeadlineHeap suits a few timers that need to fire on their exact deadline.
+Any other backend must provide the same insert(), cancel(), advance(),
+next_expiry() and size().
+
+The Waiter puts the scheduler thread to sleep between deadlines. It's a
+ConditionWaiter by default; on Linux it can be an EpollWaiter instead.
+
+Other threads never touch the timers directly. add(), cancel() and
+reschedule() push a command onto a lock-free queue, and the scheduler thread
+applies the queued commands at the top of every tick, so callers never wait
+for the scheduler. The waiter is only notified if the scheduler thread is
+asleep.
+
+A timer that doesn't need to fire exactly on time can be given a slack. Its
+deadline is then rounded up to the next multiple of the slack, so timers with
+the same slack whose deadlines fall in the same window expire together, on
+one wakeup, at most slack late. The jitter still spreads the timers across
+the windows; it's only the spread within a window that's given up.
+
+The scheduler thread reads the clock once at the top of a tick and once after
+each callback, and each reading is shared: it starts the next callback and
+times the one before.
+
+By default the callbacks run on the scheduler thread, so a slow one delays
+every timer after it. With set_executor(), the scheduler thread only keeps
+time and hands each due callback to a WorkStealingPool. A timer whose previous
+callback is still running when it's due again skips that iteration, which is
+counted as a missed interval.
+
+Every timer keeps a CostEstimate of how long its callback takes. With
+set_admission(), a tick whose callbacks are predicted to run past the start of
+the earliest of their next intervals is overloaded, and its low-priority
+callbacks are shed or deferred so the others stay on schedule. This only
+applies when callbacks run on the scheduler thread.
+*/
+template <typename Backend = TimingWheel, typename Waiter = ConditionWaiter>
+class Scheduler {
+public:
+    using TimerId = uint64_t;
+
+    // Pass to start() to let the scheduler thread run on any CPU
+    static const int ANY_CPU = -1;
+
+private:
+    struct Entry : TimerNode {
+        TimerId                 id = 0;
+        resolution              interval;
+        // The jitter range
+        resolution              jitter_min{0};
+        resolution              jitter_max{0};
+        resolution              jitter;
+        // Deadlines are rounded up to a multiple of this, if it isn't 0
+        resolution              slack{0};
+        my_clock::time_point    interval_current_start;
+        my_clock::time_point    interval_next_start;
+        std::function<void(resolution)> do_it;
+        Priority                priority = Priority::NORMAL;
+        // How long do_it takes, when it runs on the scheduler thread
+        CostEstimate            cost;
+        bool                    cancelled = false;
+        // Set while an executor runs its callback
+        std::atomic<bool>       in_flight{false};
+    };
+
+    // A change to the timers, queued by any thread for the scheduler thread
+    struct Command {
+        enum Kind { ADD, CANCEL, RESCHEDULE };
+
+        Kind                    kind = ADD;
+        TimerId                 id = 0;
+        // The new timer, for ADD
+        std::unique_ptr<Entry>  entry;
+        // The new interval and jitter range, for RESCHEDULE
+        resolution              interval{0};
+        resolution              jitter_min{0};
+        resolution              jitter_max{0};
+    };
+
+    // Statistics recorded by one executor worker
+    struct WorkerStats {
+        std::mutex              mutex;
+        SchedulerStats          stats;
+    };
+
+    // Everything below, except for the atomics and the commands, is only
+    // touched by the scheduler thread while it runs.
+    Backend                 backend_;
+    MpscQueue<Command>      commands_;
+    Waiter                  waiter_;
+    std::atomic<bool>       is_running_{false};
+    // Set while the scheduler thread is asleep, or about to be
+    std::atomic<bool>       sleeping_{false};
+    std::future<uint64_t>   pending_;
+    int                     cpu_ = ANY_CPU;
+    std::unordered_map<TimerId, std::unique_ptr<Entry>> entries_;
+    std::atomic<size_t>     size_{0};
+    // Commands the scheduler thread has applied
+    std::atomic<uint64_t>   commands_applied_{0};
+    // Timers whose callbacks are being run by the scheduler thread
+    std::vector<Entry*>     due_;
+    // Low-priority timers put off until the end of the tick
+    std::vector<Entry*>     deferred_;
+    Admission               admission_ = Admission::OFF;
+    // Cancelled timers to delete once their callbacks return
+    std::vector<Entry*>     retired_;
+    std::atomic<TimerId>    next_id_{1};
+    JitterGenerator         gen_;
+    // The clock reading the scheduler thread is working from. It's read once
+    // at the top of a tick and once after each callback, and each reading
+    // serves as the next callback's start time.
+    my_clock::time_point    tick_now_;
+    TickStats               tick_stats_;
+    // Guards stats_, which other threads read
+    std::mutex              stats_mutex_;
+    SchedulerStats          stats_;
+    WorkStealingPool*       executor_ = nullptr;
+    std::vector<std::unique_ptr<WorkerStats>> worker_stats_;
+    std::atomic<size_t>     in_flight_count_{0};
+    // PR_SET_TIMERSLACK for the scheduler thread, if it isn't 0
+    resolution              thread_slack_{0};
+
+    //! @brief set an entry's deadline for its current interval: the start of
+    // the interval plus its jitter, rounded up to a multiple of its slack.
+    static void
+        set_deadline(Entry* entry) {
+        my_clock::time_point deadline = entry->interval_current_start
+            + entry->jitter;
+        if (entry->slack.count() > 0) {
+            resolution::rep since_epoch = deadline.time_since_epoch().count();
+            resolution::rep slack = entry->slack.count();
+            deadline = my_clock::time_point(
+                resolution((since_epoch + slack - 1) / slack * slack));
+        }
+
+        entry->deadline = deadline;
+    }
+
+    //! @brief a random jitter in the entry's range.
+    resolution
+        draw_jitter(const Entry* entry) {
+        return resolution(uniform_in(gen_, entry->jitter_min.count(),
+                                     entry->jitter_max.count()));
+    }
+
+    //! @brief move an entry to its next interval and put it back in the
+    // backend.
+    void
+        rearm(Entry* entry) {
+        entry->jitter = draw_jitter(entry);
+        entry->interval_current_start = entry->interval_next_start;
+        entry->interval_next_start += entry->interval;
+        set_deadline(entry);
+        backend_.insert(entry);
+    }
+
+    //! @brief delete the cancelled timers whose callbacks have returned.
+    void
+        sweep_retired() {
+        auto retired = std::remove_if(retired_.begin(), retired_.end(),
+                                      [this](Entry* entry) {
+            if (entry->in_flight.load()) {
+                return false;
+            }
+
+            erase(entry->id);
+            return true;
+        });
+        retired_.erase(retired, retired_.end());
+    }
+
+    void
+        erase(TimerId id) {
+        if (entries_.erase(id) != 0) {
+            --size_;
+        }
+    }
+
+    //! @brief apply a command on the scheduler thread.
+    void
+        apply(Command& command) {
+        if (command.kind == Command::ADD) {
+            Entry* entry = command.entry.get();
+            entry->jitter = draw_jitter(entry);
+            entry->interval_current_start = my_clock::now();
+            entry->interval_next_start = entry->interval_current_start
+                + entry->interval;
+            set_deadline(entry);
+            backend_.insert(entry);
+            entries_.emplace(entry->id, std::move(command.entry));
+            ++size_;
+            return;
+        }
+
+        auto found = entries_.find(command.id);
+        if (found == entries_.end() || found->second->cancelled) {
+            return;
+        }
+
+        Entry* entry = found->second.get();
+        if (command.kind == Command::RESCHEDULE) {
+            // The deadline that's already set stands; the new interval and
+            // jitter apply from the next one.
+            entry->interval = command.interval;
+            entry->jitter_min = command.jitter_min;
+            entry->jitter_max = command.jitter_max;
+            return;
+        }
+
+        backend_.cancel(entry);
+        if (entry->in_flight.load()) {
+            // An executor is still running its callback
+            entry->cancelled = true;
+            retired_.push_back(entry);
+        } else {
+            erase(command.id);
+        }
+    }
+
+    void
+        drain_commands() {
+        Command command;
+        while (commands_.pop(command)) {
+            apply(command);
+            ++commands_applied_;
+        }
+    }
+
+    //! @brief queue a command, and wake the scheduler thread if it's asleep.
+    void
+        send(Command command) {
+        commands_.push(std::move(command));
+        if (sleeping_.load()) {
+            waiter_.notify();
+        }
+    }
+
+    //! @brief hand an entry's callback to the executor. The values it needs
+    // are copied, since the entry is re-armed before the callback runs.
+    void
+        dispatch(Entry* entry, TickStats& tick_stats) {
+        if (entry->in_flight.load()) {
+            // The previous callback is still running
+            ++tick_stats.missed_intervals;
+            return;
+        }
+
+        entry->in_flight.store(true);
+        ++in_flight_count_;
+        ++tick_stats.iterations;
+        resolution jitter = entry->jitter;
+        // Latency is measured from the deadline before slack rounded it
+        my_clock::time_point deadline = entry->interval_current_start + jitter;
+        my_clock::time_point interval_next_start = entry->interval_next_start;
+        executor_->submit([this, entry, jitter, deadline, interval_next_start]() {
+            my_clock::time_point time_start_do_it = my_clock::now();
+            entry->do_it(jitter);
+            my_clock::time_point time_current = my_clock::now();
+
+            WorkerStats& worker = *worker_stats_[executor_->current_worker()];
+            {
+                std::lock_guard<std::mutex> lock(worker.mutex);
+                if (time_start_do_it >= interval_next_start) {
+                    ++worker.stats.missed_intervals;
+                }
+
+                worker.stats.dispatch_latency.insert(time_start_do_it - deadline);
+                worker.stats.durations.insert(time_current - time_start_do_it);
+            }
+
+            entry->in_flight.store(false);
+            --in_flight_count_;
+        });
+    }
+
+    //! @brief call an entry's callback on the scheduler thread.
+    void
+        run_entry(Entry* entry, TickStats& tick_stats) {
+        my_clock::time_point time_start_do_it = tick_now_;
+        if (time_start_do_it >= entry->interval_next_start) {
+            // It couldn't start within its own interval
+            ++tick_stats.missed_intervals;
+        }
+
+        tick_stats.dispatch_latency.push_back(time_start_do_it
+            - (entry->interval_current_start + entry->jitter));
+        entry->do_it(entry->jitter);
+        tick_now_ = my_clock::now();
+        duration elapsed = tick_now_ - time_start_do_it;
+        tick_stats.durations.insert(elapsed);
+        entry->cost.insert(elapsed);
+        ++tick_stats.iterations;
+    }
+
+    //! @brief run the due callbacks on the scheduler thread, shedding or
+    // deferring low-priority ones while the tick is overloaded.
+    void
+        run_due(TickStats& tick_stats) {
+        if (admission_ == Admission::OFF) {
+            for (Entry* entry : due_) {
+                run_entry(entry, tick_stats);
+            }
+
+            return;
+        }
+
+        // The predicted time the callbacks still to run will take, and the
+        // earliest time one of them misses its interval
+        resolution backlog(0);
+        my_clock::time_point tick_end = my_clock::time_point::max();
+        for (Entry* entry : due_) {
+            backlog += entry->cost.predicted();
+            tick_end = std::min(tick_end, entry->interval_next_start);
+        }
+
+        for (Entry* entry : due_) {
+            resolution predicted = entry->cost.predicted();
+            if (entry->priority == Priority::LOW
+                && tick_now_ + backlog > tick_end) {
+                backlog -= predicted;
+                if (admission_ == Admission::DEFER) {
+                    deferred_.push_back(entry);
+                    ++tick_stats.deferred;
+                } else {
+                    ++tick_stats.shed;
+                }
+
+                continue;
+            }
+
+            run_entry(entry, tick_stats);
+            backlog -= predicted;
+        }
+
+        for (Entry* entry : deferred_) {
+            if (tick_now_ + entry->cost.predicted()
+                <= entry->interval_next_start) {
+                run_entry(entry, tick_stats);
+            } else {
+                ++tick_stats.shed;
+            }
+        }
+
+        deferred_.clear();
+    }
+
+    //! @brief run timers until stop() is called, and return the number of
+    // callbacks that were run.
+    uint64_t
+        run() {
+        uint64_t result = 0;
+        uint64_t wakeups = 0;
+        if (cpu_ != ANY_CPU) {
+            pin_current_thread(static_cast<unsigned>(cpu_));
+        }
+
+        if (thread_slack_.count() > 0) {
+            set_current_thread_timer_slack(thread_slack_);
+        }
+
+        while (is_running_.load()) {
+            drain_commands();
+            tick_now_ = my_clock::now();
+            backend_.advance(tick_now_, [this](TimerNode* node) {
+                due_.push_back(static_cast<Entry*>(node));
+            });
+
+            if (due_.empty()) {
+                // Wait for the next deadline, or for a command. Checking the
+                // queue after setting sleeping_ means a command pushed
+                // meanwhile either is seen here or notifies the waiter.
+                sleeping_.store(true);
+                if (commands_.empty() && is_running_.load()) {
+                    waiter_.wait_until(backend_.next_expiry());
+                    ++wakeups;
+                }
+
+                sleeping_.store(false);
+                continue;
+            }
+
+            TickStats& tick_stats = tick_stats_;
+            tick_stats.clear();
+            tick_stats.merged_expirations = due_.size() - 1;
+            tick_stats.wakeups = wakeups;
+            wakeups = 0;
+            if (executor_ != nullptr) {
+                for (Entry* entry : due_) {
+                    dispatch(entry, tick_stats);
+                }
+            } else {
+                run_due(tick_stats);
+            }
+
+            for (Entry* entry : due_) {
+                rearm(entry);
+            }
+
+            if (!retired_.empty()) {
+                sweep_retired();
+            }
+
+            due_.clear();
+            result += tick_stats.iterations;
+            std::lock_guard<std::mutex> lock(stats_mutex_);
+            tick_stats.merge_into(stats_);
+        }
+
+        return result;
+    }
+
+public:
+    Scheduler()
+        : gen_(random_seed()) {
+    }
+
+    ~Scheduler() {
+        if (pending_.valid()) {
+            stop();
+        }
+    }
+
+    //! @brief add a timer that calls do_it every interval, delayed by a
+    // random jitter in [jitter_min, jitter_max]. With a slack, each deadline
+    // is rounded up to a multiple of it, so it can share a wakeup with other
+    // timers. A low-priority timer may be shed or deferred when a tick is
+    // overloaded; see set_admission(). Its first interval starts when the
+    // scheduler thread picks it up. Safe to call from any thread, including
+    // from a callback, and never waits for the scheduler.
+    TimerId
+        add(resolution interval,
+            resolution jitter_min,
+            resolution jitter_max,
+            std::function<void(resolution)> do_it,
+            resolution slack = resolution(0),
+            Priority priority = Priority::NORMAL) {
+        Command command;
+        command.kind = Command::ADD;
+        command.id = next_id_++;
+        command.entry.reset(new Entry);
+        command.entry->id = command.id;
+        command.entry->interval = interval;
+        command.entry->jitter_min = jitter_min;
+        command.entry->jitter_max = jitter_max;
+        command.entry->do_it = std::move(do_it);
+        command.entry->slack = slack;
+        command.entry->priority = priority;
+
+        TimerId id = command.id;
+        send(std::move(command));
+        return id;
+    }
+
+    //! @brief stop calling a timer. Returns false if add() never returned
+    // that id. The scheduler thread cancels it before its next tick; if its
+    // callback is running, it finishes, but isn't called again.
+    bool
+        cancel(TimerId id) {
+        if (id == 0 || id >= next_id_.load()) {
+            return false;
+        }
+
+        Command command;
+        command.kind = Command::CANCEL;
+        command.id = id;
+        send(std::move(command));
+        return true;
+    }
+
+    //! @brief change a timer's interval and jitter range, from its next
+    // deadline on. Returns false if add() never returned that id.
+    bool
+        reschedule(TimerId id,
+                   resolution interval,
+                   resolution jitter_min,
+                   resolution jitter_max) {
+        if (id == 0 || id >= next_id_.load()) {
+            return false;
+        }
+
+        Command command;
+        command.kind = Command::RESCHEDULE;
+        command.id = id;
+        command.interval = interval;
+        command.jitter_min = jitter_min;
+        command.jitter_max = jitter_max;
+        send(std::move(command));
+        return true;
+    }
+
+    //! @brief run callbacks on an executor instead of the scheduler thread.
+    // Call this before start(). The executor must outlive the scheduler.
+    void
+        set_executor(WorkStealingPool* executor) {
+        executor_ = executor;
+        worker_stats_.clear();
+        if (executor != nullptr) {
+            for (size_t i = 0; i < executor->size(); ++i) {
+                worker_stats_.emplace_back(new WorkerStats);
+            }
+        }
+    }
+
+    //! @brief shed or defer low-priority callbacks in overloaded ticks, or
+    // run them all with Admission::OFF, the default. Call this before start().
+    void
+        set_admission(Admission policy) {
+        admission_ = policy;
+    }
+
+    //! @brief ask the OS to let the scheduler thread's own waits run up to
+    // slack late (PR_SET_TIMERSLACK on Linux), so the kernel can coalesce
+    // them with other wakeups. Call this before start(). Does nothing where
+    // it isn't supported.
+    void
+        set_thread_slack(resolution slack) {
+        thread_slack_ = slack;
+    }
+
+    //! @brief start the scheduler thread, pinned to the given CPU unless it
+    // is ANY_CPU.
+    void
+        start(int cpu = ANY_CPU) {
+        is_running_.store(true);
+        cpu_ = cpu;
+
+        pending_ = std::async(std::launch::async, &Scheduler::run, this);
+    }
+
+    //! @brief stop the scheduler thread and return the number of callbacks
+    // it ran. Callbacks already handed to an executor are waited for.
+    uint64_t
+        stop() {
+        is_running_.store(false);
+        waiter_.notify();
+        uint64_t result = pending_.get();
+        while (in_flight_count_.load() > 0) {
+            std::this_thread::yield();
+        }
+
+        return result;
+    }
+
+    //! @brief the number of timers, as of the last commands the scheduler
+    // thread applied.
+    size_t
+        size() {
+        return size_.load();
+    }
+
+    //! @brief the add(), cancel() and reschedule() calls the scheduler thread
+    // has applied so far, including ones made before start().
+    uint64_t
+        commands_applied() const {
+        return commands_applied_.load();
+    }
+
+    Waiter&
+        waiter() {
+        return waiter_;
+    }
+
+    SchedulerStats
+        stats() {
+        SchedulerStats result;
+        {
+            std::lock_guard<std::mutex> lock(stats_mutex_);
+            result = stats_;
+        }
+
+        for (auto& worker : worker_stats_) {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            result.merge(worker->stats);
+        }
+
+        return result;
+    }
+};
+
+
+using WheelScheduler = Scheduler<TimingWheel>;
+using HeapScheduler = Scheduler<DeadlineHeap>;
+
+#if defined(__linux__)
+using EpollScheduler = Scheduler<TimingWheel, EpollWaiter>;
+#endif
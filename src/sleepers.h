@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <utility>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <ctime>
+#endif
+
+#include "intervals.h"
+#include "platform.h"
+#include "histogram.h"
+
+
+/* The ways PeriodicTimer can sleep until its next deadline. A Sleeper is
+also the timer's clock, and has
+
+    my_clock::time_point now()
+        the current time
+    void relax()
+        called on every turn of a spin, in precision mode
+    bool sleep_until(my_clock::time_point deadline, const std::atomic<bool>& is_running)
+        returns true at the deadline, or false once is_running is cleared
+    void interrupt()
+        called by stop() after it clears is_running
+    const LatencyHistogram& lateness() const
+        how far past the deadline each sleep woke up
+    void reset(bool record)
+        clear lateness() for a new run, and only fill it if record is set
+*/
+
+
+/* Sleep on a condition variable, so stop() can wake the thread at once. The
+wait goes through steady_clock. This is the default.
+*/
+class ConditionSleeper {
+    std::mutex              mutex_;
+    std::condition_variable wakeup_;
+    LatencyHistogram        lateness_;
+    bool                    record_ = true;
+
+public:
+    my_clock::time_point
+        now() const {
+        return my_clock::now();
+    }
+
+    void
+        relax() {
+        cpu_relax();
+    }
+
+    bool
+        sleep_until(my_clock::time_point deadline,
+                    const std::atomic<bool>& is_running) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (wakeup_.wait_until(lock, deadline, [&is_running]() {
+            return !is_running.load();
+        })) {
+            return false;
+        }
+
+        if (record_) {
+            lateness_.insert(my_clock::now() - deadline);
+        }
+
+        return true;
+    }
+
+    void
+        interrupt() {
+        {
+            // Hold the lock so the flag can't change between the sleeping
+            // thread's check of it and its wait.
+            std::lock_guard<std::mutex> lock(mutex_);
+        }
+
+        wakeup_.notify_all();
+    }
+
+    const LatencyHistogram&
+        lateness() const {
+        return lateness_;
+    }
+
+    void
+        reset(bool record) {
+        lateness_ = LatencyHistogram();
+        record_ = record;
+    }
+};
+
+
+#if defined(__linux__)
+/* Sleep with clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME) on the deadline
+itself, without going through std::this_thread or a condition variable, and
+measure each wakeup with clock_gettime(CLOCK_MONOTONIC).
+
+Nothing interrupts the sleep, so stop() returns only once the current sleep
+is over. Use it to compare wakeup latency, not where stop() has to be quick.
+*/
+class NanosleepSleeper {
+    LatencyHistogram        lateness_;
+    bool                    record_ = true;
+
+    static int64_t
+        to_ns(const timespec& time) {
+        return int64_t(time.tv_sec) * 1000000000 + time.tv_nsec;
+    }
+
+public:
+    my_clock::time_point
+        now() const {
+        return my_clock::now();
+    }
+
+    void
+        relax() {
+        cpu_relax();
+    }
+
+    bool
+        sleep_until(my_clock::time_point deadline,
+                    const std::atomic<bool>& is_running) {
+        timespec target = to_monotonic_timespec(deadline);
+        // It returns the error rather than setting errno
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &target,
+                               nullptr) == EINTR) {
+        }
+
+        if (record_) {
+            timespec woke;
+            clock_gettime(CLOCK_MONOTONIC, &woke);
+            lateness_.insert(nanosec(to_ns(woke) - to_ns(target)));
+        }
+
+        return is_running.load();
+    }
+
+    void
+        interrupt() {
+    }
+
+    const LatencyHistogram&
+        lateness() const {
+        return lateness_;
+    }
+
+    void
+        reset(bool record) {
+        lateness_ = LatencyHistogram();
+        record_ = record;
+    }
+};
+#endif
+
+
+/* A virtual clock, which only moves when the timer sleeps or something calls
+advance(), so a schedule of hours can be simulated in milliseconds. It starts
+at my_clock's epoch.
+
+sleep_until() jumps straight to the deadline, plus a wakeup lateness drawn
+from the model given to set_lateness(), if any. A do_it models how long it
+runs by calling advance(). Each relax() of a spin moves the clock on by 40 ns,
+about one pause instruction, so precision mode works as well.
+
+Only the timer thread may touch it while the timer runs. stop() doesn't
+interrupt anything, since the timer never really sleeps.
+*/
+class VirtualSleeper {
+    my_clock::time_point    now_;
+    std::function<duration()> lateness_model_;
+    LatencyHistogram        lateness_;
+    bool                    record_ = true;
+
+public:
+    my_clock::time_point
+        now() const {
+        return now_;
+    }
+
+    void
+        relax() {
+        now_ += resolution(40);
+    }
+
+    //! @brief move the clock on, for example by how long a do_it would run.
+    void
+        advance(duration elapsed) {
+        now_ += elapsed;
+    }
+
+    //! @brief draw each wakeup's lateness from model, or make every wakeup
+    // exactly on time if model is empty.
+    void
+        set_lateness(std::function<duration()> model) {
+        lateness_model_ = std::move(model);
+    }
+
+    bool
+        sleep_until(my_clock::time_point deadline,
+                    const std::atomic<bool>& is_running) {
+        if (!is_running.load()) {
+            return false;
+        }
+
+        duration late = lateness_model_ ? lateness_model_() : duration(0);
+        now_ = std::max(now_, deadline + late);
+        if (record_) {
+            lateness_.insert(now_ - deadline);
+        }
+
+        return true;
+    }
+
+    void
+        interrupt() {
+    }
+
+    const LatencyHistogram&
+        lateness() const {
+        return lateness_;
+    }
+
+    void
+        reset(bool record) {
+        lateness_ = LatencyHistogram();
+        record_ = record;
+    }
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+#include "intervals.h"
+
+
+/* The part of a timer that a scheduler backend needs to know about. A backend
+only orders nodes by deadline; everything else about a timer (its interval,
+jitter and callback) lives in the scheduler's entry that derives from this.
+*/
+struct TimerNode {
+    my_clock::time_point    deadline;
+
+    // Links for the timing wheel's slot lists
+    TimerNode*              prev = nullptr;
+    TimerNode*              next = nullptr;
+    uint64_t                tick = 0;
+    uint8_t                 level = 0;
+    uint8_t                 slot = 0;
+
+    // Position in the deadline heap
+    static const size_t     NOT_IN_HEAP = static_cast<size_t>(-1);
+    size_t                  heap_index = NOT_IN_HEAP;
+
+    bool
+        linked() const {
+        return next != nullptr;
+    }
+};
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "intervals.h"
+#include "platform.h"
+#include "scheduler.h"
+
+
+/* Spread timers across several schedulers ("shards"), each with its own
+thread pinned to its own CPU. Every shard has its own backend, random number
+generator and statistics, and a timer always lives on the shard its key
+hashes to, so the shards never touch each other's data while they run.
+Statistics are merged only when they are read.
+*/
+template <typename Backend = TimingWheel>
+class TimerService {
+public:
+    // Identifies a timer in the whole service. The shard is encoded in it, so
+    // cancel() goes straight to the right shard.
+    using TimerId = uint64_t;
+
+private:
+    using Shard = Scheduler<Backend>;
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+
+    //! @brief mix the bits of a key so that keys that are close together,
+    // like consecutive client numbers, still spread evenly over the shards.
+    static uint64_t
+        hash(uint64_t key) {
+        // The finalizer of SplitMix64
+        key += 0x9e3779b97f4a7c15ULL;
+        key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        key = (key ^ (key >> 27)) * 0x94d049bb133111ebULL;
+        return key ^ (key >> 31);
+    }
+
+public:
+    //! @brief create a service with one shard per CPU, or shard_count shards.
+    explicit TimerService(size_t shard_count = cpu_count()) {
+        if (shard_count == 0) {
+            shard_count = 1;
+        }
+
+        for (size_t i = 0; i < shard_count; ++i) {
+            shards_.emplace_back(new Shard);
+        }
+    }
+
+    size_t
+        shard_count() const {
+        return shards_.size();
+    }
+
+    size_t
+        shard_of(uint64_t key) const {
+        return static_cast<size_t>(hash(key) % shards_.size());
+    }
+
+    //! @brief add a timer to the shard that key hashes to. The key is anything
+    // that identifies the work, such as a client number. See Scheduler::add()
+    // for the slack and the priority.
+    TimerId
+        add(uint64_t key,
+            resolution interval,
+            resolution jitter_min,
+            resolution jitter_max,
+            std::function<void(resolution)> do_it,
+            resolution slack = resolution(0),
+            Priority priority = Priority::NORMAL) {
+        size_t shard = shard_of(key);
+        typename Shard::TimerId local = shards_[shard]->add(interval,
+                                                            jitter_min,
+                                                            jitter_max,
+                                                            std::move(do_it),
+                                                            slack,
+                                                            priority);
+        return local * shards_.size() + shard;
+    }
+
+    bool
+        cancel(TimerId id) {
+        size_t shard = static_cast<size_t>(id % shards_.size());
+        return shards_[shard]->cancel(id / shards_.size());
+    }
+
+    //! @brief set every shard's admission control. Call this before start().
+    void
+        set_admission(Admission policy) {
+        for (auto& shard : shards_) {
+            shard->set_admission(policy);
+        }
+    }
+
+    //! @brief start every shard, each pinned to its own CPU. With more shards
+    // than CPUs, shards share CPUs round-robin.
+    void
+        start() {
+        unsigned cpus = cpu_count();
+        for (size_t i = 0; i < shards_.size(); ++i) {
+            shards_[i]->start(static_cast<int>(i % cpus));
+        }
+    }
+
+    //! @brief stop every shard and return the number of callbacks they ran.
+    uint64_t
+        stop() {
+        uint64_t result = 0;
+        for (auto& shard : shards_) {
+            result += shard->stop();
+        }
+
+        return result;
+    }
+
+    size_t
+        size() {
+        size_t result = 0;
+        for (auto& shard : shards_) {
+            result += shard->size();
+        }
+
+        return result;
+    }
+
+    SchedulerStats
+        stats() {
+        SchedulerStats result;
+        for (auto& shard : shards_) {
+            result.merge(shard->stats());
+        }
+
+        return result;
+    }
+};
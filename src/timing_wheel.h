@@ -0,0 +1,321 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "intervals.h"
+#include "timer_node.h"
+
+// The granularity of the timing wheel. 0.1 ms == 100,000 ns, which is the
+// same as JITTER_MIN, so jitter survives being rounded to a tick.
+#define WHEEL_TICK              resolution(100000)
+
+
+//! @brief return the index of the lowest set bit in a non-zero value.
+inline int
+    lowest_bit_index(uint64_t value) {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return static_cast<int>(index);
+#elif defined(_MSC_VER)
+    // 32-bit builds only scan 32 bits at a time
+    unsigned long index;
+    if (_BitScanForward(&index, static_cast<unsigned long>(value))) {
+        return static_cast<int>(index);
+    }
+
+    _BitScanForward(&index, static_cast<unsigned long>(value >> 32));
+    return static_cast<int>(index) + 32;
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
+
+/* A hierarchical timing wheel (Varghese & Lauck). Time is divided into ticks
+of WHEEL_TICK. Level 0 has one slot per tick for the next 64 ticks, level 1
+has one slot per 64 ticks for the next 64 * 64 ticks, and so on. A timer is
+placed in the lowest level whose range covers its deadline and is cascaded
+down a level each time the wheel reaches the start of its slot. Insert and
+cancel are O(1), and expiring a tick costs O(1) plus the timers that expire.
+
+Timers fire on the first tick boundary at or after their deadline, so they are
+never early and are at most one tick late.
+*/
+class TimingWheel {
+public:
+    static const int LEVEL_BITS = 6;
+    static const int SLOTS = 1 << LEVEL_BITS;
+    static const int LEVELS = 6;
+
+private:
+    struct Level {
+        // Sentinel heads of circular, doubly-linked lists of timers
+        TimerNode   slots[SLOTS];
+        // Bit n is set when slots[n] is non-empty
+        uint64_t    occupied = 0;
+    };
+
+    Level                   levels_[LEVELS];
+    // Timers beyond the range of the top level
+    TimerNode               overflow_;
+    duration                tick_;
+    my_clock::time_point    origin_;
+    uint64_t                current_ = 0;
+    size_t                  size_ = 0;
+
+    uint64_t
+        tick_of(my_clock::time_point deadline) const {
+        // Round up, so a timer never fires before its deadline
+        if (deadline <= origin_) {
+            return 0;
+        }
+
+        return static_cast<uint64_t>((deadline - origin_ + tick_ - duration(1))
+                                     / tick_);
+    }
+
+    uint64_t
+        ticks_until(my_clock::time_point now) const {
+        if (now <= origin_) {
+            return 0;
+        }
+
+        return static_cast<uint64_t>((now - origin_) / tick_);
+    }
+
+    TimerNode*
+        head_of(int level, int slot) {
+        return level == LEVELS ? &overflow_ : &levels_[level].slots[slot];
+    }
+
+    void
+        link(TimerNode* node, int level, int slot) {
+        TimerNode* head = head_of(level, slot);
+        node->level = static_cast<uint8_t>(level);
+        node->slot = static_cast<uint8_t>(slot);
+        node->prev = head->prev;
+        node->next = head;
+        head->prev->next = node;
+        head->prev = node;
+        if (level < LEVELS) {
+            levels_[level].occupied |= uint64_t(1) << slot;
+        }
+    }
+
+    void
+        unlink(TimerNode* node) {
+        node->prev->next = node->next;
+        node->next->prev = node->prev;
+        node->prev = nullptr;
+        node->next = nullptr;
+
+        TimerNode* head = head_of(node->level, node->slot);
+        if (head->next == head && node->level < LEVELS) {
+            levels_[node->level].occupied &= ~(uint64_t(1) << node->slot);
+        }
+    }
+
+    //! @brief put a node in the wheel relative to the current tick, but don't
+    // count it; node->tick is its real expiry tick.
+    void
+        place(TimerNode* node) {
+        uint64_t tick = node->tick < current_ ? current_ : node->tick;
+        int level = 0;
+        while (level < LEVELS - 1
+               && (tick >> (LEVEL_BITS * (level + 1)))
+                   != (current_ >> (LEVEL_BITS * (level + 1)))) {
+            ++level;
+        }
+
+        // Beyond the range of the wheel. It'll be placed again when the wheel
+        // starts its next lap of the top level.
+        if ((tick >> (LEVEL_BITS * LEVELS)) != (current_ >> (LEVEL_BITS * LEVELS))) {
+            link(node, LEVELS, 0);
+            return;
+        }
+
+        int slot = static_cast<int>((tick >> (LEVEL_BITS * level)) & (SLOTS - 1));
+        link(node, level, slot);
+    }
+
+    //! @brief move the timers in a slot of a higher level to lower levels.
+    void
+        cascade(int level, int slot) {
+        TimerNode* head = head_of(level, slot);
+        if (head->next == head) {
+            return;
+        }
+
+        // Take the whole list first. A timer that's still beyond the wheel
+        // goes back into the overflow list, which would otherwise never
+        // empty while it's being cascaded.
+        TimerNode pending;
+        pending.next = head->next;
+        pending.prev = head->prev;
+        pending.next->prev = &pending;
+        pending.prev->next = &pending;
+        head->next = head;
+        head->prev = head;
+        if (level < LEVELS) {
+            levels_[level].occupied &= ~(uint64_t(1) << slot);
+        }
+
+        while (pending.next != &pending) {
+            TimerNode* node = pending.next;
+            pending.next = node->next;
+            node->next->prev = &pending;
+            place(node);
+        }
+    }
+
+    //! @brief cascade every level whose slot starts at the current tick.
+    void
+        enter_current_tick() {
+        for (int level = 1; level <= LEVELS; ++level) {
+            uint64_t mask = (uint64_t(1) << (LEVEL_BITS * level)) - 1;
+            if ((current_ & mask) != 0) {
+                break;
+            }
+
+            cascade(level, static_cast<int>((current_ >> (LEVEL_BITS * level))
+                                            & (SLOTS - 1)));
+        }
+    }
+
+    //! @brief the first tick with timers in level 0, or the first tick where
+    // a higher level has to be cascaded.
+    uint64_t
+        next_tick() const {
+        for (int level = 0; level < LEVELS; ++level) {
+            int shift = LEVEL_BITS * level;
+            int index = static_cast<int>((current_ >> shift) & (SLOTS - 1));
+            // Level 0 includes the current slot. Higher levels only hold
+            // timers in slots after the current one.
+            int first = level == 0 ? index : index + 1;
+            if (first >= SLOTS) {
+                continue;
+            }
+
+            uint64_t bits = levels_[level].occupied & (~uint64_t(0) << first);
+            if (bits != 0) {
+                uint64_t base = (current_ >> (shift + LEVEL_BITS))
+                    << (shift + LEVEL_BITS);
+                return base | (uint64_t(lowest_bit_index(bits)) << shift);
+            }
+        }
+
+        if (overflow_.next != &overflow_) {
+            return ((current_ >> (LEVEL_BITS * LEVELS)) + 1) << (LEVEL_BITS * LEVELS);
+        }
+
+        return std::numeric_limits<uint64_t>::max();
+    }
+
+public:
+    explicit TimingWheel(my_clock::time_point origin = my_clock::now(),
+                         duration tick = WHEEL_TICK)
+        : tick_(tick)
+        , origin_(origin) {
+        for (auto& level : levels_) {
+            for (auto& head : level.slots) {
+                head.prev = &head;
+                head.next = &head;
+            }
+        }
+
+        overflow_.prev = &overflow_;
+        overflow_.next = &overflow_;
+    }
+
+    // The slot heads point at themselves, so a wheel can't be copied
+    TimingWheel(const TimingWheel&) = delete;
+    TimingWheel& operator=(const TimingWheel&) = delete;
+
+    void
+        insert(TimerNode* node) {
+        node->tick = tick_of(node->deadline);
+        place(node);
+        ++size_;
+    }
+
+    //! @brief remove a timer that hasn't expired. Returns false if the timer
+    // wasn't in the wheel.
+    bool
+        cancel(TimerNode* node) {
+        if (!node->linked()) {
+            return false;
+        }
+
+        unlink(node);
+        --size_;
+        return true;
+    }
+
+    //! @brief expire every timer whose tick has been reached by now, calling
+    // expire(TimerNode*) for each after it has been removed from the wheel.
+    // expire must not insert into the wheel; re-arm timers after this returns.
+    template <typename Expire>
+    void
+        advance(my_clock::time_point now, Expire expire) {
+        uint64_t target = ticks_until(now);
+
+        for (;;) {
+            TimerNode* head = &levels_[0].slots[current_ & (SLOTS - 1)];
+            while (head->next != head) {
+                TimerNode* node = head->next;
+                unlink(node);
+                --size_;
+                expire(node);
+            }
+
+            if (current_ >= target) {
+                break;
+            }
+
+            // Skip the ticks in which nothing happens
+            uint64_t next = size_ == 0 ? target : next_tick();
+            if (next > target) {
+                next = target;
+            }
+
+            if (next <= current_) {
+                next = current_ + 1;
+            }
+
+            current_ = next;
+            enter_current_tick();
+        }
+    }
+
+    //! @brief the time at which advance() next has work to do, or
+    // time_point::max() if the wheel is empty.
+    my_clock::time_point
+        next_expiry() const {
+        if (size_ == 0) {
+            return my_clock::time_point::max();
+        }
+
+        return origin_ + tick_ * static_cast<duration::rep>(next_tick());
+    }
+
+    duration
+        granularity() const {
+        return tick_;
+    }
+
+    size_t
+        size() const {
+        return size_;
+    }
+
+    bool
+        empty() const {
+        return size_ == 0;
+    }
+};
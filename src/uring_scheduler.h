@@ -0,0 +1,838 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <random>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "intervals.h"
+#include "scheduler.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define INTERVALS_HAVE_IO_URING 1
+#endif
+#endif
+
+#if defined(INTERVALS_HAVE_IO_URING)
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+
+
+/* A minimal io_uring: the submission and completion rings mapped into this
+process, driven with the raw system calls so liburing isn't needed. Only the
+thread that runs the scheduler touches it.
+*/
+class URing {
+    int                 fd_ = -1;
+    void*               sq_ring_ = nullptr;
+    size_t              sq_ring_size_ = 0;
+    void*               cq_ring_ = nullptr;
+    size_t              cq_ring_size_ = 0;
+    io_uring_sqe*       sqes_ = nullptr;
+    size_t              sqes_size_ = 0;
+
+    unsigned*           sq_head_ = nullptr;
+    unsigned*           sq_tail_ = nullptr;
+    unsigned            sq_mask_ = 0;
+    unsigned            sq_entries_ = 0;
+    unsigned*           sq_array_ = nullptr;
+    unsigned*           cq_head_ = nullptr;
+    unsigned*           cq_tail_ = nullptr;
+    unsigned            cq_mask_ = 0;
+    io_uring_cqe*       cqes_ = nullptr;
+
+    // Entries queued but not yet handed to the kernel
+    unsigned            to_submit_ = 0;
+    uint64_t            enter_calls_ = 0;
+
+    template <typename T>
+    static T*
+        at(void* base, uint32_t offset) {
+        return reinterpret_cast<T*>(static_cast<char*>(base) + offset);
+    }
+
+    void
+        release() {
+        if (sqes_ != nullptr) {
+            munmap(sqes_, sqes_size_);
+        }
+
+        if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+            munmap(cq_ring_, cq_ring_size_);
+        }
+
+        if (sq_ring_ != nullptr) {
+            munmap(sq_ring_, sq_ring_size_);
+        }
+
+        if (fd_ >= 0) {
+            close(fd_);
+        }
+
+        fd_ = -1;
+        sq_ring_ = nullptr;
+        cq_ring_ = nullptr;
+        sqes_ = nullptr;
+    }
+
+public:
+    URing() = default;
+    URing(const URing&) = delete;
+    URing& operator=(const URing&) = delete;
+
+    ~URing() {
+        release();
+    }
+
+    //! @brief set up a ring. Returns false if io_uring isn't available, for
+    // example on an old kernel or when it's disabled by policy.
+    bool
+        open(unsigned entries, unsigned completion_entries) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = completion_entries;
+
+        fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd_ < 0) {
+            return false;
+        }
+
+        sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap) {
+            if (cq_ring_size_ > sq_ring_size_) {
+                sq_ring_size_ = cq_ring_size_;
+            }
+
+            cq_ring_size_ = sq_ring_size_;
+        }
+
+        sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+        if (sq_ring_ == MAP_FAILED) {
+            sq_ring_ = nullptr;
+            release();
+            return false;
+        }
+
+        if (single_mmap) {
+            cq_ring_ = sq_ring_;
+        } else {
+            cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+            if (cq_ring_ == MAP_FAILED) {
+                cq_ring_ = nullptr;
+                release();
+                return false;
+            }
+        }
+
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) {
+            release();
+            return false;
+        }
+
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+        sq_head_ = at<unsigned>(sq_ring_, params.sq_off.head);
+        sq_tail_ = at<unsigned>(sq_ring_, params.sq_off.tail);
+        sq_mask_ = *at<unsigned>(sq_ring_, params.sq_off.ring_mask);
+        sq_entries_ = *at<unsigned>(sq_ring_, params.sq_off.ring_entries);
+        sq_array_ = at<unsigned>(sq_ring_, params.sq_off.array);
+        cq_head_ = at<unsigned>(cq_ring_, params.cq_off.head);
+        cq_tail_ = at<unsigned>(cq_ring_, params.cq_off.tail);
+        cq_mask_ = *at<unsigned>(cq_ring_, params.cq_off.ring_mask);
+        cqes_ = at<io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+        return true;
+    }
+
+    bool
+        is_open() const {
+        return fd_ >= 0;
+    }
+
+    //! @brief whether an error from the kernel may go away by itself, so the
+    // request is worth trying again.
+    static bool
+        is_transient(int error) {
+        return error == EAGAIN || error == EBUSY || error == EINTR;
+    }
+
+    //! @brief hand queued entries to the kernel, and if wait is set, block
+    // until at least one completion is ready. Returns 0, or the errno of a
+    // failed io_uring_enter.
+    int
+        enter(bool wait) {
+        unsigned flags = wait ? IORING_ENTER_GETEVENTS : 0;
+        long submitted = syscall(__NR_io_uring_enter, fd_, to_submit_,
+                                 wait ? 1 : 0, flags, nullptr, 0);
+        ++enter_calls_;
+        if (submitted < 0) {
+            return errno;
+        }
+
+        to_submit_ -= static_cast<unsigned>(submitted);
+        return 0;
+    }
+
+    //! @brief the next free submission entry, cleared. Submits what's queued
+    // first if the ring is full, and returns nullptr if that didn't make
+    // room, for the caller to try again later.
+    io_uring_sqe*
+        next_sqe() {
+        unsigned tail = *sq_tail_;
+        if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_) {
+            // The kernel takes what's submitted before enter returns
+            if (enter(false) != 0
+                || tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE)
+                    >= sq_entries_) {
+                return nullptr;
+            }
+        }
+
+        unsigned index = tail & sq_mask_;
+        io_uring_sqe* sqe = &sqes_[index];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sq_array_[index] = index;
+        return sqe;
+    }
+
+    //! @brief queue the entry returned by the last call to next_sqe().
+    void
+        queue() {
+        __atomic_store_n(sq_tail_, *sq_tail_ + 1, __ATOMIC_RELEASE);
+        ++to_submit_;
+    }
+
+    //! @brief call complete(user_data, result) for every completion that's
+    // ready.
+    template <typename Complete>
+    void
+        harvest(Complete complete) {
+        unsigned head = *cq_head_;
+        unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+            complete(cqe.user_data, cqe.res);
+            ++head;
+            if (head == tail) {
+                // Publish the free space, then check for more
+                __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+                tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+            }
+        }
+
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    }
+
+    uint64_t
+        enter_calls() const {
+        return enter_calls_;
+    }
+};
+
+#endif
+
+
+/* Periodic timers driven by io_uring. Deadlines are grouped into windows of
+ARM_SLACK, and each window with timers in it is one IORING_OP_TIMEOUT with an
+absolute CLOCK_MONOTONIC deadline at its end. The windows opened by a round of
+callbacks are queued together and handed to the kernel in the same
+io_uring_enter call that waits for the next expirations, and expirations are
+collected from the completion queue in batches.
+
+It has the same interface as Scheduler, and the same per-timer jitter and
+missed-interval accounting: a callback that starts in its next interval is a
+missed one. When io_uring isn't available (not Linux, an old kernel, or
+io_uring disabled) it runs the timers on a HeapScheduler instead.
+
+A window the kernel fails to arm is tried again if the error is a passing one
+(EAGAIN, EBUSY or EINTR), and its timers are dropped otherwise; see
+failed_timers(). If io_uring_enter itself fails for good, the scheduler thread
+stops; see error().
+*/
+class UringScheduler {
+public:
+    using TimerId = uint64_t;
+
+private:
+    std::unique_ptr<HeapScheduler> fallback_;
+
+#if defined(INTERVALS_HAVE_IO_URING)
+    // Submission and completion queue sizes
+    static const unsigned SQ_ENTRIES = 4096;
+    static const unsigned CQ_ENTRIES = 65536;
+
+    // user_data of entries that aren't windows. A window's user_data is its
+    // key, which counts ARM_SLACK periods of the monotonic clock, so it's
+    // far above these.
+    static const uint64_t WAKEUP_TAG = 1;
+    static const uint64_t REMOVE_TAG = 2;
+
+    // The width of a window. The kernel gives io_uring timeouts no timer
+    // slack, and every distinct deadline is a timer interrupt of its own: a
+    // thousand timeouts due within a millisecond keep the CPU busy until the
+    // last one has fired, and the scheduler thread can't run before then.
+    // With windows, the timers due in the same 20 us share one timeout.
+    static constexpr nanosec ARM_SLACK{20000};
+
+    struct Entry {
+        TimerId                 id = 0;
+        resolution              interval;
+        // The jitter range
+        resolution              jitter_min{0};
+        resolution              jitter_max{0};
+        resolution              jitter;
+        my_clock::time_point    interval_current_start;
+        my_clock::time_point    interval_next_start;
+        my_clock::time_point    deadline;
+        std::function<void(resolution)> do_it;
+        // The key of the window it waits in, or 0 while it isn't in one
+        uint64_t                window = 0;
+        bool                    cancelled = false;
+    };
+
+    // The timers whose deadlines fall in one window of ARM_SLACK
+    struct Window {
+        uint64_t                key = 0;
+        // The kernel reads the window's end from here when it's submitted
+        __kernel_timespec       timeout;
+        std::vector<Entry*>     entries;
+        // There's a timeout in the kernel for it
+        bool                    armed = false;
+    };
+
+    URing                   ring_;
+    int                     event_fd_ = -1;
+    uint64_t                event_count_ = 0;
+    std::mutex              mutex_;
+    bool                    is_running_ = false;
+    std::future<uint64_t>   pending_;
+    std::unordered_map<TimerId, std::unique_ptr<Entry>> entries_;
+    std::unordered_map<uint64_t, std::unique_ptr<Window>> windows_;
+    // Timers whose first interval hasn't started
+    std::vector<Entry*>     added_;
+    // Windows to hand to the kernel, and windows to take back from it
+    std::vector<Window*>    to_arm_;
+    std::vector<uint64_t>   to_remove_;
+    std::vector<Entry*>     due_;
+    TimerId                 next_id_ = 1;
+    JitterGenerator         gen_;
+    TickStats               tick_stats_;
+    SchedulerStats          stats_;
+    uint64_t                expirations_ = 0;
+    // The eventfd poll is in the ring
+    bool                    wakeup_queued_ = false;
+    // Timers dropped because the kernel wouldn't arm their window, and the
+    // last error it gave
+    uint64_t                failed_timers_ = 0;
+    int                     last_error_ = 0;
+    // The errno that ended run(), if io_uring_enter failed for good
+    int                     error_ = 0;
+
+    void
+        notify() {
+        uint64_t one = 1;
+        ssize_t written = write(event_fd_, &one, sizeof(one));
+        (void)written;
+    }
+
+    //! @brief queue a one-shot poll of the eventfd, so notify() ends a wait.
+    // Returns false if the ring is full.
+    bool
+        queue_wakeup() {
+        io_uring_sqe* sqe = ring_.next_sqe();
+        if (sqe == nullptr) {
+            return false;
+        }
+
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = event_fd_;
+        sqe->poll_events = POLLIN;
+        sqe->user_data = WAKEUP_TAG;
+        ring_.queue();
+        return true;
+    }
+
+    bool
+        queue_timeout(Window* window) {
+        nanosec::rep window_end = static_cast<nanosec::rep>(window->key)
+            * ARM_SLACK.count();
+        window->timeout.tv_sec = window_end / 1000000000;
+        window->timeout.tv_nsec = window_end % 1000000000;
+
+        io_uring_sqe* sqe = ring_.next_sqe();
+        if (sqe == nullptr) {
+            return false;
+        }
+
+        sqe->opcode = IORING_OP_TIMEOUT;
+        sqe->fd = -1;
+        sqe->addr = reinterpret_cast<uint64_t>(&window->timeout);
+        sqe->len = 1;
+        sqe->timeout_flags = IORING_TIMEOUT_ABS;
+        sqe->user_data = window->key;
+        ring_.queue();
+        window->armed = true;
+        return true;
+    }
+
+    bool
+        queue_remove(uint64_t key) {
+        io_uring_sqe* sqe = ring_.next_sqe();
+        if (sqe == nullptr) {
+            return false;
+        }
+
+        sqe->opcode = IORING_OP_TIMEOUT_REMOVE;
+        sqe->fd = -1;
+        sqe->addr = key;
+        sqe->user_data = REMOVE_TAG;
+        ring_.queue();
+        return true;
+    }
+
+    //! @brief a random jitter in the entry's range.
+    resolution
+        draw_jitter(const Entry* entry) {
+        return resolution(uniform_in(gen_, entry->jitter_min.count(),
+                                     entry->jitter_max.count()));
+    }
+
+    //! @brief put an entry in the window its deadline falls in, opening the
+    // window if it's new.
+    void
+        place(Entry* entry) {
+        auto since_epoch = std::chrono::duration_cast<nanosec>(
+            entry->deadline.time_since_epoch()).count();
+        nanosec::rep slack = ARM_SLACK.count();
+        uint64_t key = static_cast<uint64_t>((since_epoch + slack - 1) / slack);
+
+        std::unique_ptr<Window>& window = windows_[key];
+        if (!window) {
+            window.reset(new Window);
+            window->key = key;
+            to_arm_.push_back(window.get());
+        }
+
+        window->entries.push_back(entry);
+        entry->window = key;
+    }
+
+    void
+        rearm(Entry* entry) {
+        entry->jitter = draw_jitter(entry);
+        entry->interval_current_start = entry->interval_next_start;
+        entry->interval_next_start += entry->interval;
+        entry->deadline = entry->interval_current_start + entry->jitter;
+        place(entry);
+    }
+
+    //! @brief take a window's timers back after the kernel hands back its
+    // timeout with the result res.
+    void
+        complete(Window* window, int32_t res) {
+        window->armed = false;
+        if (res == -ETIME) {
+            for (Entry* entry : window->entries) {
+                entry->window = 0;
+                due_.push_back(entry);
+            }
+        } else if (res == -ECANCELED || URing::is_transient(-res)) {
+            // Removed after cancel() emptied it, or it failed to arm for the
+            // moment. Timers placed in it since then still need it.
+            if (!window->entries.empty()) {
+                to_arm_.push_back(window);
+                return;
+            }
+        } else {
+            // It would fail again, so drop its timers
+            failed_timers_ += window->entries.size();
+            last_error_ = -res;
+            for (Entry* entry : window->entries) {
+                entries_.erase(entry->id);
+            }
+        }
+
+        windows_.erase(window->key);
+    }
+
+    uint64_t
+        run() {
+        uint64_t result = 0;
+        uint64_t wakeups = 0;
+        std::unique_lock<std::mutex> lock(mutex_);
+        wakeup_queued_ = false;
+
+        while (is_running_) {
+            if (!wakeup_queued_) {
+                wakeup_queued_ = queue_wakeup();
+            }
+
+            // As in Scheduler, a new timer's first interval starts when the
+            // scheduler thread picks it up
+            if (!added_.empty()) {
+                my_clock::time_point time_picked_up = my_clock::now();
+                for (Entry* entry : added_) {
+                    if (entry->cancelled) {
+                        entries_.erase(entry->id);
+                        continue;
+                    }
+
+                    entry->interval_current_start = time_picked_up;
+                    entry->interval_next_start = time_picked_up
+                        + entry->interval;
+                    entry->deadline = time_picked_up + entry->jitter;
+                    place(entry);
+                }
+
+                added_.clear();
+            }
+
+            // What doesn't fit in the ring waits for the next round
+            size_t kept = 0;
+            for (Window* window : to_arm_) {
+                if (window->entries.empty()) {
+                    // cancel() emptied it before it was armed
+                    windows_.erase(window->key);
+                } else if (!queue_timeout(window)) {
+                    to_arm_[kept++] = window;
+                }
+            }
+
+            to_arm_.resize(kept);
+            kept = 0;
+            for (uint64_t key : to_remove_) {
+                if (!queue_remove(key)) {
+                    to_remove_[kept++] = key;
+                }
+            }
+
+            to_remove_.resize(kept);
+
+            // Submit everything queued and wait for something to complete
+            lock.unlock();
+            int error = ring_.enter(true);
+            lock.lock();
+            ++wakeups;
+            if (error != 0 && !URing::is_transient(error)) {
+                // Retrying would only spin, so stop running timers
+                error_ = error;
+                break;
+            }
+
+            bool woken = false;
+            ring_.harvest([this, &woken](uint64_t user_data, int32_t res) {
+                if (user_data == WAKEUP_TAG) {
+                    if (res < 0 && !URing::is_transient(-res)) {
+                        error_ = -res;
+                    }
+
+                    woken = true;
+                    wakeup_queued_ = false;
+                    return;
+                }
+
+                if (user_data == REMOVE_TAG) {
+                    return;
+                }
+
+                auto found = windows_.find(user_data);
+                if (found != windows_.end()) {
+                    complete(found->second.get(), res);
+                }
+            });
+
+            if (error_ != 0) {
+                // The eventfd can't be polled, so stop() couldn't end a wait
+                break;
+            }
+
+            if (woken) {
+                uint64_t count;
+                while (read(event_fd_, &count, sizeof(count)) == sizeof(count)) {
+                }
+            }
+
+            if (due_.empty()) {
+                continue;
+            }
+
+            // Run the callbacks without holding the lock, as Scheduler does
+            TickStats& tick_stats = tick_stats_;
+            tick_stats.clear();
+            tick_stats.merged_expirations = due_.size() - 1;
+            tick_stats.wakeups = wakeups;
+            wakeups = 0;
+            lock.unlock();
+            // As in Scheduler, the reading after a callback starts the next
+            my_clock::time_point time_current = my_clock::now();
+            for (Entry* entry : due_) {
+                my_clock::time_point time_start_do_it = time_current;
+                if (time_start_do_it >= entry->interval_next_start) {
+                    ++tick_stats.missed_intervals;
+                }
+
+                tick_stats.dispatch_latency.push_back(time_start_do_it
+                                                      - entry->deadline);
+                entry->do_it(entry->jitter);
+                time_current = my_clock::now();
+                tick_stats.durations.insert(time_current - time_start_do_it);
+                ++tick_stats.iterations;
+            }
+            lock.lock();
+
+            for (Entry* entry : due_) {
+                if (entry->cancelled) {
+                    entries_.erase(entry->id);
+                } else {
+                    rearm(entry);
+                }
+            }
+
+            expirations_ += due_.size();
+            due_.clear();
+            result += tick_stats.iterations;
+            tick_stats.merge_into(stats_);
+        }
+
+        return result;
+    }
+#endif
+
+public:
+    UringScheduler()
+#if defined(INTERVALS_HAVE_IO_URING)
+        : gen_(random_seed())
+#endif
+    {
+#if defined(INTERVALS_HAVE_IO_URING)
+        if (ring_.open(SQ_ENTRIES, CQ_ENTRIES)) {
+            event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            if (event_fd_ >= 0) {
+                return;
+            }
+        }
+#endif
+        fallback_.reset(new HeapScheduler);
+    }
+
+    ~UringScheduler() {
+#if defined(INTERVALS_HAVE_IO_URING)
+        if (pending_.valid()) {
+            stop();
+        }
+
+        if (event_fd_ >= 0) {
+            close(event_fd_);
+        }
+#endif
+    }
+
+    //! @brief true if the timers run on io_uring, false if they run on the
+    // fallback scheduler.
+    bool
+        uses_io_uring() const {
+        return fallback_ == nullptr;
+    }
+
+    TimerId
+        add(resolution interval,
+            resolution jitter_min,
+            resolution jitter_max,
+            std::function<void(resolution)> do_it) {
+        if (fallback_) {
+            return fallback_->add(interval, jitter_min, jitter_max,
+                                  std::move(do_it));
+        }
+
+#if defined(INTERVALS_HAVE_IO_URING)
+        std::unique_ptr<Entry> entry(new Entry);
+        entry->interval = interval;
+        entry->jitter_min = jitter_min;
+        entry->jitter_max = jitter_max;
+        entry->do_it = std::move(do_it);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        entry->id = next_id_++;
+        entry->jitter = draw_jitter(entry.get());
+        added_.push_back(entry.get());
+
+        TimerId id = entry->id;
+        entries_.emplace(id, std::move(entry));
+        notify();
+        return id;
+#else
+        return 0;
+#endif
+    }
+
+    bool
+        cancel(TimerId id) {
+        if (fallback_) {
+            return fallback_->cancel(id);
+        }
+
+#if defined(INTERVALS_HAVE_IO_URING)
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto found = entries_.find(id);
+        if (found == entries_.end() || found->second->cancelled) {
+            return false;
+        }
+
+        // A timer waiting in a window is deleted now. One that's new, or whose
+        // callback is due, is deleted when the scheduler thread gets to it.
+        Entry* entry = found->second.get();
+        entry->cancelled = true;
+        if (entry->window == 0) {
+            return true;
+        }
+
+        Window* window = windows_[entry->window].get();
+        auto& waiting = window->entries;
+        waiting.erase(std::find(waiting.begin(), waiting.end(), entry));
+        entries_.erase(found);
+        if (waiting.empty() && window->armed) {
+            to_remove_.push_back(window->key);
+            notify();
+        }
+
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    void
+        start() {
+        if (fallback_) {
+            fallback_->start();
+            return;
+        }
+
+#if defined(INTERVALS_HAVE_IO_URING)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            is_running_ = true;
+        }
+
+        pending_ = std::async(std::launch::async, &UringScheduler::run, this);
+#endif
+    }
+
+    uint64_t
+        stop() {
+        if (fallback_) {
+            return fallback_->stop();
+        }
+
+#if defined(INTERVALS_HAVE_IO_URING)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            is_running_ = false;
+        }
+
+        notify();
+        return pending_.get();
+#else
+        return 0;
+#endif
+    }
+
+    size_t
+        size() {
+        if (fallback_) {
+            return fallback_->size();
+        }
+
+#if defined(INTERVALS_HAVE_IO_URING)
+        std::lock_guard<std::mutex> lock(mutex_);
+        return entries_.size();
+#else
+        return 0;
+#endif
+    }
+
+    SchedulerStats
+        stats() {
+        if (fallback_) {
+            return fallback_->stats();
+        }
+
+#if defined(INTERVALS_HAVE_IO_URING)
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+#else
+        return SchedulerStats();
+#endif
+    }
+
+    //! @brief io_uring_enter calls per expired timer so far, or 0 on the
+    // fallback scheduler.
+    double
+        syscalls_per_expiration() {
+#if defined(INTERVALS_HAVE_IO_URING)
+        if (!fallback_) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (expirations_ != 0) {
+                return static_cast<double>(ring_.enter_calls())
+                    / static_cast<double>(expirations_);
+            }
+        }
+#endif
+        return 0.0;
+    }
+
+    //! @brief timers dropped because the kernel refused to arm them with an
+    // error that wouldn't go away, such as EINVAL or ENOMEM, and the errno of
+    // the last one. Always 0 on the fallback scheduler.
+    uint64_t
+        failed_timers(int* last_error = nullptr) {
+#if defined(INTERVALS_HAVE_IO_URING)
+        if (!fallback_) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (last_error != nullptr) {
+                *last_error = last_error_;
+            }
+
+            return failed_timers_;
+        }
+#endif
+        if (last_error != nullptr) {
+            *last_error = 0;
+        }
+
+        return 0;
+    }
+
+    //! @brief the errno that stopped the scheduler thread when io_uring failed
+    // for good, or 0 while it's fine. Timers stop running then; stop() still
+    // returns their iterations.
+    int
+        error() {
+#if defined(INTERVALS_HAVE_IO_URING)
+        if (!fallback_) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return error_;
+        }
+#endif
+        return 0;
+    }
+};
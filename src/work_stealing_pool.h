@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstddef>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+
+#include "platform.h"
+
+
+/* A pool of worker threads that run tasks handed to them by a scheduler, so
+a slow callback only holds up the worker it runs on, not the timing thread.
+
+Every worker has its own deque of tasks. Tasks submitted from outside the pool
+are dealt out to the workers round-robin, and a task submitted by a worker
+goes on its own deque. Workers take tasks from the front of a deque, oldest
+first, since that's the one whose deadline has waited longest: their own
+deque first, and when it's empty, the front of the other workers' deques. A
+task queued behind a slow callback is then the first one another worker
+takes, not the last.
+*/
+class WorkStealingPool {
+public:
+    static const size_t NOT_A_WORKER = static_cast<size_t>(-1);
+
+private:
+    struct Worker {
+        std::mutex                          mutex;
+        std::deque<std::function<void()>>   tasks;
+    };
+
+    std::vector<std::unique_ptr<Worker>>    workers_;
+    std::vector<std::thread>                threads_;
+    // Sleeping workers wait on idle_ until there are queued tasks
+    std::mutex                              idle_mutex_;
+    std::condition_variable                 idle_;
+    bool                                    is_running_ = true;
+    std::atomic<size_t>                     queued_;
+    std::atomic<size_t>                     next_worker_;
+
+    struct Current {
+        const WorkStealingPool* pool = nullptr;
+        size_t                  index = NOT_A_WORKER;
+    };
+
+    static Current&
+        current() {
+        thread_local Current worker;
+        return worker;
+    }
+
+    bool
+        pop(size_t self, std::function<void()>& task) {
+        {
+            Worker& own = *workers_[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.front());
+                own.tasks.pop_front();
+                return true;
+            }
+        }
+
+        for (size_t i = 1; i < workers_.size(); ++i) {
+            Worker& victim = *workers_[(self + i) % workers_.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    void
+        work(size_t self) {
+        current().pool = this;
+        current().index = self;
+
+        for (;;) {
+            std::function<void()> task;
+            if (pop(self, task)) {
+                --queued_;
+                task();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(idle_mutex_);
+            idle_.wait(lock, [this]() {
+                return queued_.load() > 0 || !is_running_;
+            });
+
+            if (!is_running_ && queued_.load() == 0) {
+                return;
+            }
+        }
+    }
+
+public:
+    explicit WorkStealingPool(size_t thread_count = cpu_count())
+        : queued_(0)
+        , next_worker_(0) {
+        if (thread_count == 0) {
+            thread_count = 1;
+        }
+
+        for (size_t i = 0; i < thread_count; ++i) {
+            workers_.emplace_back(new Worker);
+        }
+
+        for (size_t i = 0; i < thread_count; ++i) {
+            threads_.emplace_back(&WorkStealingPool::work, this, i);
+        }
+    }
+
+    //! @brief run the tasks that are still queued, then stop the workers.
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(idle_mutex_);
+            is_running_ = false;
+        }
+
+        idle_.notify_all();
+        for (auto& thread : threads_) {
+            thread.join();
+        }
+    }
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    size_t
+        size() const {
+        return workers_.size();
+    }
+
+    //! @brief the index of the pool's worker running the calling thread, or
+    // NOT_A_WORKER when called from any other thread.
+    size_t
+        current_worker() const {
+        return current().pool == this ? current().index : NOT_A_WORKER;
+    }
+
+    void
+        submit(std::function<void()> task) {
+        size_t target = current_worker();
+        if (target == NOT_A_WORKER) {
+            target = next_worker_++ % workers_.size();
+        }
+
+        // Count the task before it can be popped, so a worker's decrement
+        // never comes first and wraps queued_ around
+        ++queued_;
+        {
+            Worker& worker = *workers_[target];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.tasks.push_back(std::move(task));
+        }
+
+        {
+            // Don't notify a worker between its check of queued_ and its wait
+            std::lock_guard<std::mutex> lock(idle_mutex_);
+        }
+
+        idle_.notify_one();
+    }
+};
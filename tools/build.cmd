@@ -26,4 +26,19 @@ IF %build% EQU 1 (
     %CommonLinkerFlagsFinal% /ENTRY:mainCRTStartup
     copy %DIR_OUT_BIN%\Intervals.exe !DIR_REPO!
 )
+
+:: Build each benchmark into its own executable
+IF %bench% EQU 1 (
+    IF %verbose% EQU 1 (
+        ECHO.
+        ECHO Build benchmarks
+    )
+    FOR %%F IN (!DIR_REPO!\bench\*.cpp) DO (
+        cl %CommonCompilerFlagsFinal% ^
+        /I%DIR_INCLUDE% /I!DIR_REPO!\src ^
+        %%F /Fo:%DIR_OUT_OBJ%\ ^
+        /Fd:%DIR_OUT_BIN%\%%~nF.pdb /Fe:%DIR_OUT_BIN%\%%~nF.exe /link ^
+        %CommonLinkerFlagsFinal% /ENTRY:mainCRTStartup
+    )
+)
 ENDLOCAL
@@ -18,6 +18,7 @@ SETLOCAL ENABLEDELAYEDEXPANSION ENABLEEXTENSIONS
 ::  x86:        specifies a 32-bit build.
 ::  win32:      specifies a 32-bit build.
 ::  test:       build the current configuration and run all unit tests.
+::  bench:      build the benchmarks in the bench directory as well.
 ::  vs2017:     use Visual Studio 2017. The scripts will search for MS Build,
 ::              Pro, and Community Edition in that order.
 ::  vs2019:     use Visual Studio 2019. The scripts will search for MS Build,
@@ -28,7 +29,7 @@ SETLOCAL ENABLEDELAYEDEXPANSION ENABLEEXTENSIONS
 ::  trace:      Display the values of these options.
 
 :: Remember to export these in the ENDLOCAL section below
-SET "options=build: debug: release: cleanall: clean: cleanbuild: x64: x86: win32: test: vs2017: vs2019: vs2022: verbose: trace:"
+SET "options=build: debug: release: cleanall: clean: cleanbuild: x64: x86: win32: test: bench: vs2017: vs2019: vs2022: verbose: trace:"
 :: Initialize flags to zero
 FOR %%O in (%options%) DO FOR /f "tokens=1,* delims=:" %%A in ("%%O") DO (
     if NOT "%%~B"=="" (
@@ -103,6 +104,7 @@ ENDLOCAL & (
     SET "x86=%x86%"
     SET "win32=%win32%"
     SET "test=%test%"
+    SET "bench=%bench%"
     SET "vs2017=%vs2017%"
     SET "vs2019=%vs2019%"
     SET "vs2022=%vs2022%"
@@ -30,12 +30,15 @@ SET DIR_COMMON_SCRIPTS=%DIR_REPO%\tools
 
 CALL %DIR_COMMON_SCRIPTS%\options.cmd %*
 
-:: If "build" is not set, then set it if test is set or if neither clean nor
-:: cleanall are set
+:: If "build" is not set, then set it if test or bench is set or if neither
+:: clean nor cleanall are set
 if %build% EQU 0 (
     if %test% EQU 1 (
         SET build=1
     )
+    if %bench% EQU 1 (
+        SET build=1
+    )
     if %cleanall% EQU 0 (
         if %clean% EQU 0 (
             if %cleanbuild% EQU 0 (
@@ -193,6 +196,7 @@ ENDLOCAL & (
     SET "x64=%x64%"
     SET "x86=%x86%"
     SET "test=%test%"
+    SET "bench=%bench%"
     SET "vs2017=%vs2017%"
     SET "vs2019=%vs2019%"
     SET "vs2022=%vs2022%"